@@ -0,0 +1,221 @@
+// Copyright 2022 Roy T. Hashimoto. All Rights Reserved.
+
+// Micro-benchmarks for API functions that call WebAssembly exports
+// directly or move data in bulk. Each benchmark times the API against a
+// baseline doing the same work the previous way, and the results are
+// written as JSON to stdout.
+//
+// Usage: yarn bench-bindings [--runs N] [--build DIR]
+//
+// --runs      Number of times to run each benchmark (default 5).
+// --build     Directory containing the WebAssembly builds (default dist,
+//             e.g. perf for the output of make perf).
+import * as SQLite from '../src/sqlite-api.js';
+
+const options = {
+  runs: 5,
+  build: 'dist'
+};
+for (let i = 2; i < process.argv.length; ++i) {
+  const arg = process.argv[i];
+  const value = process.argv[++i];
+  switch (arg) {
+    case '--runs': options.runs = Number(value); break;
+    case '--build': options.build = value; break;
+    default:
+      console.error(`unknown argument ${arg}`);
+      process.exit(1);
+  }
+}
+
+const { default: factory } = await import(`../${options.build}/wa-sqlite.mjs`);
+const Module = await factory();
+const sqlite3 = SQLite.Factory(Module);
+
+const N_ROWS = 1000000;
+const SQL = `
+  WITH RECURSIVE numbers(n) AS
+    (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT ${N_ROWS})
+    SELECT n, n * 2 FROM numbers;
+`;
+
+/**
+ * Each benchmark is called with a fresh in-memory database and
+ * returns the elapsed milliseconds of the baseline and of the API.
+ * @type {Array<{ name: string, run: (db: number) => Promise<{ baseline: number, api: number }> }>}
+ */
+const BENCHMARKS = [
+  {
+    // Column reads through the cwrap wrappers used before, and through
+    // the API, which calls the exports directly.
+    name: 'column',
+    async run(db) {
+      const column_type = Module.cwrap('sqlite3_column_type', 'number', ['number', 'number']);
+      const column_int = Module.cwrap('sqlite3_column_int', 'number', ['number', 'number']);
+
+      async function run(getColumn) {
+        let elapsed = 0;
+        for await (const stmt of sqlite3.statements(db, SQL)) {
+          while (await sqlite3.step(stmt) === SQLite.SQLITE_ROW) {
+            const start = performance.now();
+            for (let i = 0; i < 2; ++i) {
+              getColumn(stmt, i);
+            }
+            elapsed += performance.now() - start;
+          }
+        }
+        return elapsed;
+      }
+
+      const baseline = await run((stmt, i) => {
+        column_type(stmt, i);
+        return column_int(stmt, i);
+      });
+      const api = await run((stmt, i) => {
+        sqlite3.column_type(stmt, i);
+        return sqlite3.column_int(stmt, i);
+      });
+      return { baseline, api };
+    }
+  },
+  {
+    // Wide text like the VARCHAR(100) column of benchmark tests 2 and 3,
+    // with an ASCII column and a column with multi-byte characters, read
+    // with cwrap string conversion as before and with the API.
+    name: 'column_text',
+    async run(db) {
+      await sqlite3.exec(db, `
+        CREATE TABLE t2(a INTEGER, b TEXT, c TEXT);
+        WITH RECURSIVE numbers(n) AS
+          (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT 25000)
+          INSERT INTO t2
+            SELECT n, substr(hex(randomblob(50)), 1, 100), 'caf\u00e9 ' || n FROM numbers;
+      `);
+      const column_text = Module.cwrap('sqlite3_column_text', 'string', ['number', 'number']);
+
+      async function run(getText) {
+        let elapsed = 0;
+        for (let pass = 0; pass < 10; ++pass) {
+          for await (const stmt of sqlite3.statements(db, 'SELECT b, c FROM t2 ORDER BY a')) {
+            while (await sqlite3.step(stmt) === SQLite.SQLITE_ROW) {
+              const start = performance.now();
+              for (let i = 0; i < 2; ++i) {
+                getText(stmt, i);
+              }
+              elapsed += performance.now() - start;
+            }
+          }
+        }
+        return elapsed;
+      }
+
+      const baseline = await run(column_text);
+      const api = await run((stmt, i) => sqlite3.column_text(stmt, i));
+      return { baseline, api };
+    }
+  },
+  {
+    // The same scalar function with pointer arguments read with
+    // sqlite3.value, and with arguments decoded in C.
+    name: 'function',
+    async run(db) {
+      sqlite3.create_function(db, 'add_values', 2, SQLite.SQLITE_UTF8, 0, (context, values) => {
+        sqlite3.result(context, sqlite3.value(values[0]) + sqlite3.value(values[1]));
+      });
+      sqlite3.create_function_decoded(db, 'add_decoded', 2, SQLite.SQLITE_UTF8, 0, (context, args) => {
+        sqlite3.result(context, args[0] + args[1]);
+      });
+
+      const baseline = await time(db, `
+        WITH RECURSIVE numbers(n) AS
+          (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT ${N_ROWS})
+          SELECT sum(add_values(n, n * 0.5)) FROM numbers;
+      `);
+      const api = await time(db, `
+        WITH RECURSIVE numbers(n) AS
+          (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT ${N_ROWS})
+          SELECT sum(add_decoded(n, n * 0.5)) FROM numbers;
+      `);
+      return { baseline, api };
+    }
+  },
+  {
+    // The same sum of products as an aggregate called per row, and as a
+    // column aggregate called once with columns.
+    name: 'column aggregate',
+    async run(db) {
+      let sum = 0;
+      sqlite3.create_function(db, 'dot_rows', 2, SQLite.SQLITE_UTF8, 0, null,
+        (context, values) => {
+          sum += sqlite3.value_double(values[0]) * sqlite3.value_double(values[1]);
+        },
+        context => {
+          sqlite3.result(context, sum);
+          sum = 0;
+        });
+      sqlite3.create_column_aggregate(db, 'dot_columns', 2, SQLite.SQLITE_UTF8, 0, (context, [a, b]) => {
+        let sum = 0;
+        for (let i = 0; i < a.length; ++i) {
+          sum += a[i] * b[i];
+        }
+        sqlite3.result(context, sum);
+      });
+
+      const baseline = await time(db, `
+        WITH RECURSIVE numbers(n) AS
+          (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT ${N_ROWS})
+          SELECT dot_rows(n, 0.5) FROM numbers;
+      `);
+      const api = await time(db, `
+        WITH RECURSIVE numbers(n) AS
+          (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT ${N_ROWS})
+          SELECT dot_columns(n, 0.5) FROM numbers;
+      `);
+      return { baseline, api };
+    }
+  }
+];
+
+const results = {
+  build: options.build,
+  runs: options.runs,
+  benchmarks: {}
+};
+for (const { name, run } of BENCHMARKS) {
+  const times = { baseline: [], api: [] };
+  for (let i = 0; i < options.runs; ++i) {
+    console.error(`${name}: run ${i + 1} of ${options.runs}`);
+    const db = await sqlite3.open_v2(':memory:');
+    try {
+      const { baseline, api } = await run(db);
+      times.baseline.push(baseline);
+      times.api.push(api);
+    } finally {
+      await sqlite3.close(db);
+    }
+  }
+  results.benchmarks[name] = {
+    baseline: median(times.baseline),
+    api: median(times.api)
+  };
+}
+console.log(JSON.stringify(results, null, 2));
+
+/**
+ * Elapsed milliseconds to execute SQL.
+ * @param {number} db
+ * @param {string} sql
+ */
+async function time(db, sql) {
+  const start = performance.now();
+  await sqlite3.exec(db, sql);
+  return performance.now() - start;
+}
+
+/**
+ * @param {number[]} values
+ */
+function median(values) {
+  const sorted = values.slice().sort((a, b) => a - b);
+  return sorted[Math.floor((sorted.length - 1) / 2)];
+}
@@ -0,0 +1,165 @@
+// Copyright 2022 Roy T. Hashimoto. All Rights Reserved.
+
+// Headless benchmark harness. This runs the demo/benchmarks.js workloads
+// in Node and writes per-test statistics as JSON to stdout.
+//
+// Usage: yarn bench [--runs N] [--build DIR] [--vfs NAME...] [--preamble SQL]
+//
+// --runs      Number of times to run the full suite (default 5).
+// --build     Directory containing the WebAssembly builds (default dist,
+//             e.g. perf for the output of make perf).
+// --vfs       Only run configurations whose label includes NAME. May be
+//             repeated.
+// --preamble  SQL to execute before the tests (default DELETE journal).
+//
+// The IndexedDB VFS configurations run only if the fake-indexeddb
+// package can be imported. It is not a dependency of this package, so
+// install it separately to measure them. Configurations that were not
+// run are listed under "skipped" in the output.
+import * as SQLite from '../src/sqlite-api.js';
+import { TESTS } from '../demo/benchmark-tests.js';
+import { installWebLocks } from './web-locks.js';
+
+const options = {
+  runs: 5,
+  build: 'dist',
+  vfs: [],
+  preamble: 'PRAGMA journal_mode=delete;'
+};
+for (let i = 2; i < process.argv.length; ++i) {
+  const arg = process.argv[i];
+  const value = process.argv[++i];
+  switch (arg) {
+    case '--runs': options.runs = Number(value); break;
+    case '--build': options.build = value; break;
+    case '--vfs': options.vfs.push(value); break;
+    case '--preamble': options.preamble = value; break;
+    default:
+      console.error(`unknown argument ${arg}`);
+      process.exit(1);
+  }
+}
+
+// Install browser APIs that the example VFS classes expect before they
+// are loaded.
+installWebLocks();
+const hasIndexedDB = await import('fake-indexeddb/auto').then(() => true, () => false);
+
+const { MemoryVFS } = await import('../src/examples/MemoryVFS.js');
+const { MemoryAsyncVFS } = await import('../src/examples/MemoryAsyncVFS.js');
+
+const [SQLiteModule, SQLiteAsyncModule] = await Promise.all([
+  import(`../${options.build}/wa-sqlite.mjs`).then(({ default: factory }) => factory()),
+  import(`../${options.build}/wa-sqlite-async.mjs`).then(({ default: factory }) => factory())
+]);
+const sqlite3s = SQLite.Factory(SQLiteModule);
+const sqlite3a = SQLite.Factory(SQLiteAsyncModule);
+
+sqlite3s.vfs_register(new MemoryVFS());
+sqlite3a.vfs_register(new MemoryVFS());
+sqlite3a.vfs_register(new MemoryAsyncVFS());
+
+/** @type {Record<string, string>} */
+const skipped = {};
+
+/** @type {Array<[string, SQLiteAPI, string]>} */
+const configs = [
+  ['default', sqlite3s, undefined],
+  ['memory (sync)', sqlite3s, 'memory'],
+  ['memory (async)', sqlite3a, 'memory'],
+  ['memory-async', sqlite3a, 'memory-async']
+];
+
+if (hasIndexedDB) {
+  const { IDBMinimalVFS } = await import('../src/examples/IDBMinimalVFS.js');
+  const { IDBBatchAtomicVFS } = await import('../src/examples/IDBBatchAtomicVFS.js');
+  sqlite3a.vfs_register(new IDBMinimalVFS('idb-minimal-benchmark'));
+  sqlite3a.vfs_register(new IDBBatchAtomicVFS('idb-batch-atomic-benchmark'));
+  configs.push(
+    ['idb-minimal', sqlite3a, 'idb-minimal-benchmark'],
+    ['idb-batch-atomic', sqlite3a, 'idb-batch-atomic-benchmark']);
+} else {
+  for (const label of ['idb-minimal', 'idb-batch-atomic']) {
+    skipped[label] = 'fake-indexeddb not installed';
+  }
+}
+
+const results = {
+  build: options.build,
+  runs: options.runs,
+  preamble: options.preamble,
+  configs: {},
+  skipped
+};
+for (const [label, sqlite3, vfs] of configs) {
+  if (options.vfs.length && !options.vfs.some(name => label.includes(name))) {
+    continue;
+  }
+
+  // Collect elapsed times for each test over all runs.
+  const times = TESTS.map(() => []);
+  for (let run = 0; run < options.runs; ++run) {
+    console.error(`${label}: run ${run + 1} of ${options.runs}`);
+    let i = 0;
+    for await (const elapsed of benchmark(sqlite3, vfs)) {
+      times[i++].push(elapsed);
+    }
+  }
+
+  results.configs[label] = Object.fromEntries(TESTS.map((test, i) => {
+    const sorted = times[i].sort((a, b) => a - b);
+    return [test.name, {
+      median: percentile(sorted, 0.5),
+      p95: percentile(sorted, 0.95)
+    }];
+  }));
+}
+console.log(JSON.stringify(results, null, 2));
+for (const [label, reason] of Object.entries(skipped)) {
+  if (!options.vfs.length || options.vfs.some(name => label.includes(name))) {
+    console.error(`skipped ${label}: ${reason}`);
+  }
+}
+
+/**
+ * Run the test suite once, yielding the elapsed milliseconds for each
+ * test.
+ * @param {SQLiteAPI} sqlite3
+ * @param {string} vfs
+ */
+async function* benchmark(sqlite3, vfs) {
+  const db = await sqlite3.open_v2('benchmark', undefined, vfs);
+  try {
+    // Delete all tables.
+    const tables = [];
+    await sqlite3.exec(db, `
+      SELECT name FROM sqlite_master WHERE type='table';
+    `, row => {
+      tables.push(row[0]);
+    });
+    for (const table of tables) {
+      await sqlite3.exec(db, `DROP TABLE ${table}`);
+    }
+
+    await sqlite3.exec(db, options.preamble);
+
+    for (const test of TESTS) {
+      const start = performance.now();
+      await test(sqlite3, db);
+      yield performance.now() - start;
+    }
+  }
+  finally {
+    await sqlite3.close(db);
+  }
+}
+
+/**
+ * Nearest-rank percentile of sorted values.
+ * @param {number[]} sorted
+ * @param {number} p
+ */
+function percentile(sorted, p) {
+  const rank = Math.ceil(p * sorted.length);
+  return sorted[Math.max(rank - 1, 0)];
+}
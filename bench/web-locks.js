@@ -0,0 +1,78 @@
+// Copyright 2022 Roy T. Hashimoto. All Rights Reserved.
+
+// Minimal single-process implementation of the Web Locks API
+// (navigator.locks) for running the example VFS classes in Node. Only
+// request() with exclusive and shared modes is supported.
+class LockManager {
+  /** @type {Map<string, { mode: string, grant: () => void }[]>} */
+  #queues = new Map();
+
+  /** @type {Map<string, { mode: string, count: number }>} */
+  #held = new Map();
+
+  request(name, options, callback) {
+    if (typeof options === 'function') {
+      callback = options;
+      options = {};
+    }
+    const mode = options.mode ?? 'exclusive';
+
+    return new Promise((resolve, reject) => {
+      const queue = this.#queues.get(name) ?? [];
+      this.#queues.set(name, queue);
+      queue.push({
+        mode,
+        grant: () => {
+          // The lock is held until the callback result settles.
+          Promise.resolve()
+            .then(() => callback({ name, mode }))
+            .then(resolve, reject)
+            .finally(() => this.#release(name));
+        }
+      });
+      this.#process(name);
+    });
+  }
+
+  #process(name) {
+    const queue = this.#queues.get(name);
+    let held = this.#held.get(name);
+    while (queue.length) {
+      // Shared requests can be granted together; exclusive requests
+      // must wait for all other holders.
+      const next = queue[0];
+      if (held && (held.mode === 'exclusive' || next.mode === 'exclusive')) break;
+
+      queue.shift();
+      held = held ?? { mode: next.mode, count: 0 };
+      held.count++;
+      this.#held.set(name, held);
+      next.grant();
+    }
+    if (!queue.length) this.#queues.delete(name);
+  }
+
+  #release(name) {
+    const held = this.#held.get(name);
+    if (--held.count === 0) {
+      this.#held.delete(name);
+    }
+    if (this.#queues.has(name)) {
+      this.#process(name);
+    }
+  }
+}
+
+/**
+ * Install navigator.locks if the runtime does not provide it. This
+ * must be called before importing modules that check for it.
+ */
+export function installWebLocks() {
+  globalThis.navigator ??= /** @type {*} */ ({});
+  if (!navigator['locks']) {
+    Object.defineProperty(navigator, 'locks', {
+      value: new LockManager(),
+      configurable: true
+    });
+  }
+}
@@ -6,6 +6,28 @@ export * from './sqlite-constants.js';
 export class Base {
   mxPathName = 64;
 
+  // Number of bytes to reserve for the VFS in each SQLite file object.
+  // This memory can be located with fileData(), e.g. to store file
+  // state that can be read and written with the heap arrays.
+  fileDataSize = 0;
+
+  // Set this to true if file size changes only via xWrite and xTruncate
+  // while SQLite holds a lock, so xFileSize results for database files
+  // can be cached between locks.
+  cacheFileSize = false;
+
+  // WebAssembly heap access ({ malloc, free, HEAP8, HEAPU8 }), injected
+  // on registration. This is only needed by a VFS that keeps file data
+  // in the heap, e.g. to implement xFetch.
+  heap = null;
+
+  // The default implementations of xSync, xLock, xUnlock,
+  // xCheckReservedLock, xFileControl, xSectorSize and
+  // xDeviceCharacteristics are handled without calling Javascript
+  // unless a subclass overrides them. Overrides may call the defaults
+  // with super. xSectorSize() and xDeviceCharacteristics() are called
+  // at most once per open file.
+
   /**
    * @param {number} fileId 
    * @returns {number|Promise<number>}
@@ -146,6 +168,17 @@ export class Base {
     return VFS.SQLITE_IOERR;
   }
 
+  /**
+   * Get the address of the fileDataSize bytes reserved for the VFS in
+   * an SQLite file object. This implementation will be overridden on
+   * registration.
+   * @param {number} fileId 
+   * @returns {number}
+   */
+  fileData(fileId) {
+    return 0;
+  }
+
   /**
    * Handle asynchronous operation. This implementation will be overriden on
    * registration by an Asyncify build.
@@ -157,6 +190,14 @@ export class Base {
   }
 }
 
+// Mark the methods that registration can skip, as described above.
+for (const name of [
+  'xSync', 'xLock', 'xUnlock', 'xCheckReservedLock', 'xFileControl',
+  'xSectorSize', 'xDeviceCharacteristics'
+]) {
+  Base.prototype[name].isDefault = true;
+}
+
 export const FILE_TYPE_MASK = [
   VFS.SQLITE_OPEN_MAIN_DB,
   VFS.SQLITE_OPEN_MAIN_JOURNAL,
@@ -165,4 +206,5 @@ export const FILE_TYPE_MASK = [
   VFS.SQLITE_OPEN_TRANSIENT_DB,
   VFS.SQLITE_OPEN_SUBJOURNAL,
   VFS.SQLITE_OPEN_SUPER_JOURNAL
-].reduce((mask, element) => mask | element);
\ No newline at end of file
+].reduce((mask, element) => mask | element);
+
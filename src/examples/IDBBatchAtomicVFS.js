@@ -41,6 +41,7 @@ function log(...args) {
  * 
  * @property {Set<number>} [changedPages]
  * @property {boolean} [overwrite]
+ * @property {Map<number, FileBlock>} [readAhead] blocks keyed by position
  */
 
 // This sample VFS stores optionally versioned writes to IndexedDB, which
@@ -131,6 +132,16 @@ export class IDBBatchAtomicVFS extends VFS.Base {
   }
 
   xRead(fileId, pData, iOffset) {
+    // Complete the read synchronously if a single read-ahead block
+    // covers it. Note that the asynchronous path below must not add
+    // read-ahead blocks, because with Asyncify this method is called
+    // again after the Promise resolves and must take the same path.
+    const cached = this.#mapIdToFile.get(fileId).readAhead?.get(iOffset);
+    if (cached && cached.data.length >= pData.value.length) {
+      pData.value.set(cached.data.subarray(0, pData.value.length));
+      return VFS.SQLITE_OK;
+    }
+
     return this.handleAsync(async () => {
       const file = this.#mapIdToFile.get(fileId);
       log(`xRead ${file.path} ${pData.value.length} ${iOffset}`);
@@ -173,39 +184,44 @@ export class IDBBatchAtomicVFS extends VFS.Base {
     });
   }
 
+  xReadAhead(fileId, iOffset, iAmt) {
+    return this.handleAsync(async () => {
+      const file = this.#mapIdToFile.get(fileId);
+      log(`xReadAhead ${file.path} ${iAmt} ${iOffset}`);
+
+      try {
+        // Fetch all blocks starting in the range with a single request.
+        // There may be multiple versions at an offset; use the oldest
+        // version not older than block 0, as #bound() does.
+        const version = file.block0.version;
+        const blocks = await this.#idb.run('readonly', ({blocks}) => {
+          return blocks.getAll(IDBKeyRange.bound(
+            [file.path, 1 - (iOffset + iAmt), -Infinity],
+            [file.path, -Math.max(iOffset, 1), Infinity]));
+        });
+
+        const readAhead = new Map();
+        for (const block of blocks) {
+          if (block.version >= version && !readAhead.has(-block.offset)) {
+            readAhead.set(-block.offset, block);
+          }
+        }
+        file.readAhead = readAhead;
+        return VFS.SQLITE_OK;
+      } catch (e) {
+        console.error(e);
+        return VFS.SQLITE_IOERR;
+      }
+    });
+  }
+
   xWrite(fileId, pData, iOffset) {
     const file = this.#mapIdToFile.get(fileId);
     log(`xWrite ${file.path} ${pData.value.length} ${iOffset}`);
 
     try {
-      // Convert the write directly into an IndexedDB object. Our assumption
-      // is that SQLite will only overwrite data with an xWrite of the same
-      // offset and size unless the database page size changes, except when
-      // changing database page size which is handled by #reblockIfNeeded().
-      const prevFileSize = file.block0.fileSize;
-      file.block0.fileSize = Math.max(file.block0.fileSize, iOffset + pData.value.length);
-      const block = iOffset === 0 ? file.block0 : {
-        path: file.path,
-        offset: -iOffset,
-        version: file.block0.version,
-        data: null
-      };
-      block.data = pData.value.slice();
-
-      if (file.changedPages) {
-        // This write is part of a batch atomic write. All writes in the
-        // batch have a new version, so update the changed list to allow
-        // old versions to be eventually deleted.
-        if (prevFileSize === file.block0.fileSize) {
-          file.changedPages.add(-iOffset);
-        }
-
-        // Defer writing block 0 to IndexedDB until batch commit.
-        if (iOffset !== 0) {
-          this.#idb.run('readwrite', ({blocks}) => blocks.put(block));
-        }
-      } else {
-        // Not a batch atomic write so write through.
+      const block = this.#prepareWrite(file, pData.value, iOffset);
+      if (block) {
         this.#idb.run('readwrite', ({blocks}) => blocks.put(block));
       }
       return VFS.SQLITE_OK;
@@ -215,11 +231,40 @@ export class IDBBatchAtomicVFS extends VFS.Base {
     }
   }
 
+  // Defining this method has the C glue buffer writes and pass them all
+  // together before the next call for the file (e.g. xSync or a file
+  // control), so a transaction needs only one call instead of one call
+  // per page.
+  xWriteBatch(fileId, writes) {
+    const file = this.#mapIdToFile.get(fileId);
+    log(`xWriteBatch ${file.path} ${writes.length}`);
+
+    try {
+      const puts = [];
+      for (const { offset, data } of writes) {
+        const block = this.#prepareWrite(file, data, offset);
+        if (block) puts.push(block);
+      }
+      if (puts.length) {
+        this.#idb.run('readwrite', ({blocks}) => {
+          for (const block of puts) {
+            blocks.put(block);
+          }
+        });
+      }
+      return VFS.SQLITE_OK;
+    } catch (e) {
+      console.error(e);
+      return VFS.SQLITE_IOERR;
+    }
+  }
+
   xTruncate(fileId, iSize) {
     const file = this.#mapIdToFile.get(fileId);
     log(`xTruncate ${file.path} ${iSize}`);
 
     try {
+      file.readAhead = null;
       Object.assign(file.block0, {
         fileSize: iSize,
         data: file.block0.data.slice(0, iSize)
@@ -275,6 +320,7 @@ export class IDBBatchAtomicVFS extends VFS.Base {
         const result = await this.#webLocks.lock(file.path, flags);
         if (result === VFS.SQLITE_OK && flags === VFS.SQLITE_LOCK_SHARED) {
           // Update block 0 in case another connection changed it.
+          file.readAhead = null;
           file.block0 = await this.#idb.run('readonly', ({blocks}) => {
             return blocks.get(this.#bound(file, 0));
           });
@@ -356,6 +402,7 @@ export class IDBBatchAtomicVFS extends VFS.Base {
             // Prepare a new version for IndexedDB blocks.
             file.block0.version--;
             file.changedPages = new Set();
+            file.readAhead = null;
 
             // Clear blocks from abandoned transactions that would conflict
             // with the new transaction.
@@ -415,6 +462,7 @@ export class IDBBatchAtomicVFS extends VFS.Base {
             // be left in IndexedDB to be removed by the next atomic write
             // transaction.
             file.changedPages = null;
+            file.readAhead = null;
             file.block0 = await this.#idb.run('readonly', ({blocks}) => {
               return blocks.get([file.path, 0, file.block0.version + 1]);
             });
@@ -517,6 +565,41 @@ export class IDBBatchAtomicVFS extends VFS.Base {
     this.#pendingPurges.add(path);
   }
 
+  // Update file state for a write and return the IndexedDB object to
+  // store, or null if storing is deferred.
+  #prepareWrite(file, data, iOffset) {
+    file.readAhead = null;
+
+    // Convert the write directly into an IndexedDB object. Our assumption
+    // is that SQLite will only overwrite data with an xWrite of the same
+    // offset and size unless the database page size changes, except when
+    // changing database page size which is handled by #reblockIfNeeded().
+    const prevFileSize = file.block0.fileSize;
+    file.block0.fileSize = Math.max(file.block0.fileSize, iOffset + data.length);
+    const block = iOffset === 0 ? file.block0 : {
+      path: file.path,
+      offset: -iOffset,
+      version: file.block0.version,
+      data: null
+    };
+    block.data = data.slice();
+
+    if (file.changedPages) {
+      // This write is part of a batch atomic write. All writes in the
+      // batch have a new version, so update the changed list to allow
+      // old versions to be eventually deleted.
+      if (prevFileSize === file.block0.fileSize) {
+        file.changedPages.add(-iOffset);
+      }
+
+      // Defer writing block 0 to IndexedDB until batch commit.
+      return iOffset !== 0 ? block : null;
+    }
+
+    // Not a batch atomic write so write through.
+    return block;
+  }
+
   #bound(file, begin, end = 0) {
     // Fetch newest block 0. For other blocks, use block 0 version.
     const version = !begin || -begin < file.block0.data.length ?
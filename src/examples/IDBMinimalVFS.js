@@ -23,6 +23,7 @@ const DEFAULT_OPTIONS = { durability: "default" };
  * @property {string} path
  * @property {number} flags
  * @property {number} fileSize
+ * @property {Map<number, FileBlock>} [readAhead] blocks keyed by position
  */
 
 /**
@@ -112,6 +113,16 @@ export class IDBMinimalVFS extends VFS.Base {
   }
 
   xRead(fileId, pData, iOffset) {
+    // Complete the read synchronously if a read-ahead block covers it.
+    // The asynchronous path must not add read-ahead blocks so that it
+    // is taken again when Asyncify calls this method after the Promise
+    // resolves.
+    const cached = this.#mapIdToFile.get(fileId).readAhead?.get(iOffset);
+    if (cached && cached.data.length >= pData.value.length) {
+      pData.value.set(cached.data.subarray(0, pData.value.length));
+      return VFS.SQLITE_OK;
+    }
+
     return this.handleAsync(async () => {
       const file = this.#mapIdToFile.get(fileId);
       log(`xRead ${file.path} ${pData.value.length} ${iOffset}`);
@@ -140,11 +151,31 @@ export class IDBMinimalVFS extends VFS.Base {
     });
   }
 
+  xReadAhead(fileId, iOffset, iAmt) {
+    return this.handleAsync(async () => {
+      const file = this.#mapIdToFile.get(fileId);
+      log(`xReadAhead ${file.path} ${iAmt} ${iOffset}`);
+
+      try {
+        // Fetch all blocks starting in the range with a single request.
+        const blocks = await this.#idb.run('readonly', ({blocks}) => {
+          return blocks.getAll(this.#bound(file, 1 - (iOffset + iAmt), -iOffset));
+        });
+        file.readAhead = new Map(blocks.map(block => [-block.offset, block]));
+        return VFS.SQLITE_OK;
+      } catch (e) {
+        console.error(e);
+        return VFS.SQLITE_IOERR;
+      }
+    });
+  }
+
   xWrite(fileId, pData, iOffset) {
     const file = this.#mapIdToFile.get(fileId);
     log(`xWrite ${file.path} ${pData.value.length} ${iOffset}`);
 
     try {
+      file.readAhead = null;
       // Convert the write directly into an IndexedDB object.
       const block = {
         path: file.path,
@@ -165,6 +196,7 @@ export class IDBMinimalVFS extends VFS.Base {
     log(`xTruncate ${file.path} ${iSize}`);
 
     try {
+      file.readAhead = null;
       file.fileSize = iSize;
       this.#idb.run('readwrite', ({blocks})=> {
         blocks.delete(this.#bound(file, -Infinity, -iSize));
@@ -216,7 +248,9 @@ export class IDBMinimalVFS extends VFS.Base {
       try {
         const result = await this.#webLocks.lock(file.path, flags);
         if (result === VFS.SQLITE_OK && flags === VFS.SQLITE_LOCK_SHARED) {
-          // Update cached file size when lock is acquired.
+          // Update cached file size when lock is acquired. Read-ahead
+          // blocks may have been changed by another connection.
+          file.readAhead = null;
           const lastBlock = await this.#idb.run('readonly', ({blocks}) => {
             return blocks.get(this.#bound(file, -Infinity));
           });
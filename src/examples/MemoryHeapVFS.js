@@ -0,0 +1,257 @@
+// Copyright 2021 Roy T. Hashimoto. All Rights Reserved.
+import * as VFS from '../VFS.js';
+
+// File data is stored in fixed-size chunks allocated in the WebAssembly
+// heap. Chunks never move, so SQLite can be given pointers directly into
+// them. The chunk size must be a multiple of the largest page size.
+const CHUNK_SIZE = 65536;
+
+// Memory filesystem that keeps file data in the WebAssembly heap. This
+// allows SQLite to use memory-mapped I/O (enabled with PRAGMA mmap_size)
+// to access database pages without copying them into its page cache.
+export class MemoryHeapVFS extends VFS.Base {
+  name = 'memory-heap';
+
+  // File size only changes via xWrite and xTruncate.
+  cacheFileSize = true;
+
+  // Map of existing files, keyed by filename.
+  mapNameToFile = new Map();
+
+  // Map of open files, keyed by id (sqlite3_file pointer).
+  mapIdToFile = new Map();
+
+  constructor() {
+    super();
+  }
+
+  /**
+   * @param {string?} name
+   * @param {number} fileId
+   * @param {number} flags
+   * @param {{ set: function(number): void }} pOutFlags
+   * @returns {number|Promise<number>}
+   */
+  xOpen(name, fileId, flags, pOutFlags) {
+    // Generate a random name if requested.
+    name = name || Math.floor(Math.random() * Number.MAX_SAFE_INTEGER).toString(36);
+
+    let file = this.mapNameToFile.get(name);
+    if (!file) {
+      if (flags & VFS.SQLITE_OPEN_CREATE) {
+        // Create a new file object.
+        file = {
+          name,
+          flags,
+          size: 0,
+          chunks: [],
+          nOpen: 0,
+          nFetch: 0
+        };
+        this.mapNameToFile.set(name, file);
+      } else {
+        return VFS.SQLITE_CANTOPEN;
+      }
+    }
+
+    // Put the file in the opened files map.
+    this.mapIdToFile.set(fileId, file);
+    file.nOpen++;
+    pOutFlags.set(flags);
+    return VFS.SQLITE_OK;
+  }
+
+  /**
+   * @param {number} fileId
+   * @returns {number|Promise<number>}
+   */
+  xClose(fileId) {
+    const file = this.mapIdToFile.get(fileId);
+    this.mapIdToFile.delete(fileId);
+    file.nOpen--;
+
+    if (file.flags & VFS.SQLITE_OPEN_DELETEONCLOSE) {
+      this.mapNameToFile.delete(file.name);
+    }
+    this.#release(file);
+    return VFS.SQLITE_OK;
+  }
+
+  /**
+   * @param {number} fileId
+   * @param {{ size: number, value: Int8Array }} pData
+   * @param {number} iOffset
+   * @returns {number|Promise<number>}
+   */
+  xRead(fileId, pData, iOffset) {
+    const file = this.mapIdToFile.get(fileId);
+
+    // Clip the requested read to the file boundary.
+    const bgn = Math.min(iOffset, file.size);
+    const end = Math.min(iOffset + pData.size, file.size);
+    const nBytes = end - bgn;
+
+    const dst = pData.value;
+    const heap8 = this.heap.HEAP8;
+    for (let position = bgn; position < end;) {
+      const chunkOffset = position % CHUNK_SIZE;
+      const n = Math.min(end - position, CHUNK_SIZE - chunkOffset);
+      const src = file.chunks[Math.floor(position / CHUNK_SIZE)] + chunkOffset;
+      dst.set(heap8.subarray(src, src + n), position - bgn);
+      position += n;
+    }
+
+    if (nBytes < pData.size) {
+      // Zero unused area of read buffer.
+      dst.fill(0, nBytes);
+      return VFS.SQLITE_IOERR_SHORT_READ;
+    }
+    return VFS.SQLITE_OK;
+  }
+
+  /**
+   * @param {number} fileId
+   * @param {{ size: number, value: Int8Array }} pData
+   * @param {number} iOffset
+   * @returns {number|Promise<number>}
+   */
+  xWrite(fileId, pData, iOffset) {
+    const file = this.mapIdToFile.get(fileId);
+    const end = iOffset + pData.size;
+    while (file.chunks.length * CHUNK_SIZE < end) {
+      // Allocate zero-filled chunks to hold more data.
+      const chunk = this.heap.malloc(CHUNK_SIZE);
+      if (!chunk) return VFS.SQLITE_NOMEM;
+      this.heap.HEAP8.fill(0, chunk, chunk + CHUNK_SIZE);
+      file.chunks.push(chunk);
+    }
+
+    // Copy data. Note that the source view is created after any heap
+    // allocation because memory growth replaces the heap buffer.
+    const src = pData.value;
+    const heap8 = this.heap.HEAP8;
+    for (let position = iOffset; position < end;) {
+      const chunkOffset = position % CHUNK_SIZE;
+      const n = Math.min(end - position, CHUNK_SIZE - chunkOffset);
+      const dst = file.chunks[Math.floor(position / CHUNK_SIZE)] + chunkOffset;
+      heap8.set(src.subarray(position - iOffset, position - iOffset + n), dst);
+      position += n;
+    }
+    file.size = Math.max(file.size, end);
+    return VFS.SQLITE_OK;
+  }
+
+  /**
+   * @param {number} fileId
+   * @param {number} iSize
+   * @returns {number|Promise<number>}
+   */
+  xTruncate(fileId, iSize) {
+    const file = this.mapIdToFile.get(fileId);
+    file.size = Math.min(file.size, iSize);
+
+    // Zero the tail of the last chunk so the file can be extended again.
+    // Unused chunks are freed unless SQLite holds pointers into them.
+    const nChunks = Math.ceil(file.size / CHUNK_SIZE);
+    if (file.size % CHUNK_SIZE) {
+      const chunk = file.chunks[nChunks - 1];
+      this.heap.HEAP8.fill(0, chunk + file.size % CHUNK_SIZE, chunk + CHUNK_SIZE);
+    }
+    if (!file.nFetch) {
+      for (const chunk of file.chunks.splice(nChunks)) {
+        this.heap.free(chunk);
+      }
+    } else {
+      for (const chunk of file.chunks.slice(nChunks)) {
+        this.heap.HEAP8.fill(0, chunk, chunk + CHUNK_SIZE);
+      }
+    }
+    return VFS.SQLITE_OK;
+  }
+
+  /**
+   * @param {number} fileId
+   * @param {{ set: function(number): void }} pSize64
+   * @returns {number|Promise<number>}
+   */
+  xFileSize(fileId, pSize64) {
+    const file = this.mapIdToFile.get(fileId);
+
+    pSize64.set(file.size);
+    return VFS.SQLITE_OK;
+  }
+
+  /**
+   * Return a pointer to file data if the requested range is contained
+   * in a single chunk, otherwise a null pointer to have SQLite use xRead.
+   * @param {number} fileId
+   * @param {number} iOffset
+   * @param {number} iAmt
+   * @param {{ set: function(number): void }} pp
+   * @returns {number|Promise<number>}
+   */
+  xFetch(fileId, iOffset, iAmt, pp) {
+    const file = this.mapIdToFile.get(fileId);
+    const iChunk = Math.floor(iOffset / CHUNK_SIZE);
+    if (iOffset + iAmt <= file.size &&
+        iChunk === Math.floor((iOffset + iAmt - 1) / CHUNK_SIZE)) {
+      pp.set(file.chunks[iChunk] + iOffset % CHUNK_SIZE);
+      file.nFetch++;
+    } else {
+      pp.set(0);
+    }
+    return VFS.SQLITE_OK;
+  }
+
+  /**
+   * @param {number} fileId
+   * @param {number} iOffset
+   * @param {number} pData pointer returned by xFetch, or 0
+   * @returns {number|Promise<number>}
+   */
+  xUnfetch(fileId, iOffset, pData) {
+    const file = this.mapIdToFile.get(fileId);
+    if (pData) {
+      file.nFetch--;
+    }
+    return VFS.SQLITE_OK;
+  }
+
+  /**
+   *
+   * @param {string} name
+   * @param {number} syncDir
+   * @returns {number|Promise<number>}
+   */
+  xDelete(name, syncDir) {
+    const file = this.mapNameToFile.get(name);
+    if (file) {
+      this.mapNameToFile.delete(name);
+      this.#release(file);
+    }
+    return VFS.SQLITE_OK;
+  }
+
+  /**
+   * @param {string} name
+   * @param {number} flags
+   * @param {{ set: function(number): void }} pResOut
+   * @returns {number|Promise<number>}
+   */
+  xAccess(name, flags, pResOut) {
+    const file = this.mapNameToFile.get(name);
+    pResOut.set(file ? 1 : 0);
+    return VFS.SQLITE_OK;
+  }
+
+  // Free heap memory for a file that is neither open nor reachable by
+  // name.
+  #release(file) {
+    if (!file.nOpen && this.mapNameToFile.get(file.name) !== file) {
+      for (const chunk of file.chunks) {
+        this.heap.free(chunk);
+      }
+      file.chunks = [];
+    }
+  }
+}
@@ -6,6 +6,9 @@ import * as VFS from '../VFS.js';
 export class MemoryVFS extends VFS.Base {
   name = 'memory';
   
+  // File size only changes via xWrite and xTruncate.
+  cacheFileSize = true;
+
   // Map of existing files, keyed by filename.
   mapNameToFile = new Map();
 
@@ -136,6 +139,21 @@ export class MemoryVFS extends VFS.Base {
     return VFS.SQLITE_OK;
   }
 
+  /**
+   * Defining this method enables WAL mode. The WAL index is kept in the
+   * WebAssembly heap, which is fine because these files are only
+   * visible to this context anyway.
+   * @param {number} fileId 
+   * @param {number} iRegion 
+   * @param {number} szRegion 
+   * @param {number} bExtend 
+   * @param {{ size: number, value: Int8Array }} pData 
+   * @returns {number|Promise<number>}
+   */
+  xShmMap(fileId, iRegion, szRegion, bExtend, pData) {
+    return VFS.SQLITE_OK;
+  }
+
   /**
    * 
    * @param {string} name 
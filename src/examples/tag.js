@@ -27,11 +27,15 @@ import * as SQLite from '../sqlite-api.js';
     });
     const sql = interleaved.join('');
 
-    // Loop over the SQL statements. sqlite3.statements is an API
-    // convenience function (not in the C API) that iterates over
-    // compiled statements, automatically managing resources.
+    // Loop over the SQL statements. sqlite3.prepare_cached is an API
+    // convenience function (not in the C API) that compiles the first
+    // statement and returns the remaining SQL. Compiled statements are
+    // cached by SQL text, so repeated queries are not parsed again.
     const results = [];
-    for await (const stmt of sqlite3.statements(db, sql)) {
+    let prepared = { stmt: null, tail: sql };
+    while (prepared.tail &&
+           (prepared = await sqlite3.prepare_cached(db, prepared.tail))) {
+      const stmt = prepared.stmt;
       const rows = [];
       const columns = sqlite3.column_names(stmt);
       while (await sqlite3.step(stmt) === SQLite.SQLITE_ROW) {
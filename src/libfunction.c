@@ -1,15 +1,152 @@
 // Copyright 2021 Roy T. Hashimoto. All Rights Reserved.
 #include <emscripten.h>
+#include <math.h>
 #include <sqlite3.h>
+#include <string.h>
 
 extern void jsFunc(void* pApp, sqlite3_context* pContext, int iCount, sqlite3_value** ppValues);
+extern void jsFuncDecoded(void* pApp, sqlite3_context* pContext, int iCount, const void* pArgs);
 extern void jsStep(void* pApp, sqlite3_context* pContext, int iCount, sqlite3_value** ppValues);
 extern void jsFinal(void* pApp, sqlite3_context* pContext);
+extern void jsValue(void* pApp, sqlite3_context* pContext);
+extern void jsInverse(void* pApp, sqlite3_context* pContext, int iCount, sqlite3_value** ppValues);
+extern void jsAuxDataDelete(void* pAux);
+extern void jsColumnFinal(void* pApp, sqlite3_context* pContext, int nRows, int nStride, const double* aValues);
 
 static void xFunc(sqlite3_context* pContext, int iCount, sqlite3_value** ppValues) {
   jsFunc(sqlite3_user_data(pContext), pContext, iCount, ppValues);
 }
 
+// Function arguments decoded for Javascript. The payload is the value
+// as a double for INTEGER and FLOAT, and a pointer to the data for TEXT
+// and BLOB (fetched as in librows.c). This layout is read by
+// jsFuncDecoded in libfunction.js.
+typedef struct FunctionArg {
+  int type;
+  int nBytes;
+  union {
+    double number;
+    const void* pData;
+  } u;
+} FunctionArg;
+
+// Decoded arguments are written to a shared buffer that is grown as
+// needed. Javascript reads it before calling the function, so a nested
+// call may reuse it.
+static FunctionArg* aFunctionArgs = 0;
+static int nFunctionArgs = 0;
+
+static void xFuncDecoded(sqlite3_context* pContext, int iCount, sqlite3_value** ppValues) {
+  if (iCount > nFunctionArgs) {
+    FunctionArg* aNew = (FunctionArg*)sqlite3_realloc(
+      aFunctionArgs, iCount * sizeof(FunctionArg));
+    if (!aNew) {
+      sqlite3_result_error_nomem(pContext);
+      return;
+    }
+    aFunctionArgs = aNew;
+    nFunctionArgs = iCount;
+  }
+
+  for (int i = 0; i < iCount; ++i) {
+    FunctionArg* pArg = &aFunctionArgs[i];
+    pArg->type = sqlite3_value_type(ppValues[i]);
+    switch (pArg->type) {
+      case SQLITE_INTEGER:
+      case SQLITE_FLOAT:
+        pArg->nBytes = 0;
+        pArg->u.number = sqlite3_value_double(ppValues[i]);
+        break;
+      case SQLITE_TEXT:
+        pArg->u.pData = sqlite3_value_text(ppValues[i]);
+        pArg->nBytes = sqlite3_value_bytes(ppValues[i]);
+        break;
+      case SQLITE_BLOB:
+        pArg->u.pData = sqlite3_value_blob(ppValues[i]);
+        pArg->nBytes = sqlite3_value_bytes(ppValues[i]);
+        break;
+      default:
+        pArg->nBytes = 0;
+        pArg->u.pData = 0;
+        break;
+    }
+  }
+  jsFuncDecoded(sqlite3_user_data(pContext), pContext, iCount, aFunctionArgs);
+}
+
+// Column aggregates collect their arguments as doubles (NaN for NULL)
+// for all the rows in a group and pass them to Javascript as columns
+// in one call from xFinal. Each column holds nAlloc values, nRows of
+// them used. The number of buffered values is limited so a large group
+// fails with SQLITE_TOOBIG instead of exhausting memory.
+#define COLUMN_AGGREGATE_MAX_VALUES (1 << 24)
+
+typedef struct ColumnAggregate {
+  double* aValues;
+  int nRows;
+  int nAlloc;
+} ColumnAggregate;
+
+static void xColumnStep(sqlite3_context* pContext, int iCount, sqlite3_value** ppValues) {
+  ColumnAggregate* pState = (ColumnAggregate*)sqlite3_aggregate_context(
+    pContext, sizeof(ColumnAggregate));
+  if (!pState) {
+    sqlite3_result_error_nomem(pContext);
+    return;
+  }
+
+  if (pState->nRows == pState->nAlloc) {
+    // Grow each column geometrically up to the limit.
+    const int nMax = COLUMN_AGGREGATE_MAX_VALUES / iCount;
+    if (pState->nAlloc >= nMax) {
+      sqlite3_result_error_toobig(pContext);
+      return;
+    }
+    int nAlloc = pState->nAlloc ? pState->nAlloc * 2 : 256;
+    if (nAlloc > nMax) nAlloc = nMax;
+    double* aValues = (double*)sqlite3_malloc64(
+      (sqlite3_uint64)nAlloc * iCount * sizeof(double));
+    if (!aValues) {
+      sqlite3_result_error_nomem(pContext);
+      return;
+    }
+    for (int i = 0; i < iCount; ++i) {
+      memcpy(
+        aValues + i * nAlloc,
+        pState->aValues + i * pState->nAlloc,
+        pState->nRows * sizeof(double));
+    }
+    sqlite3_free(pState->aValues);
+    pState->aValues = aValues;
+    pState->nAlloc = nAlloc;
+  }
+
+  for (int i = 0; i < iCount; ++i) {
+    pState->aValues[i * pState->nAlloc + pState->nRows] =
+      sqlite3_value_type(ppValues[i]) == SQLITE_NULL ?
+        NAN :
+        sqlite3_value_double(ppValues[i]);
+  }
+  ++pState->nRows;
+}
+
+static void xColumnFinal(sqlite3_context* pContext) {
+  // SQLite calls xFinal even after an error, so the values are always
+  // freed here. A group with no rows has no aggregate context.
+  ColumnAggregate* pState = (ColumnAggregate*)sqlite3_aggregate_context(pContext, 0);
+  if (pState) {
+    jsColumnFinal(
+      sqlite3_user_data(pContext),
+      pContext,
+      pState->nRows,
+      pState->nAlloc,
+      pState->aValues);
+    sqlite3_free(pState->aValues);
+  } else {
+    jsColumnFinal(sqlite3_user_data(pContext), pContext, 0, 0, 0);
+  }
+}
+
 static void xStep(sqlite3_context* pContext, int iCount, sqlite3_value** ppValues) {
   jsStep(sqlite3_user_data(pContext), pContext, iCount, ppValues);
 }
@@ -18,6 +155,18 @@ static void xFinal(sqlite3_context* pContext) {
   jsFinal(sqlite3_user_data(pContext), pContext);
 }
 
+static void xValue(sqlite3_context* pContext) {
+  jsValue(sqlite3_user_data(pContext), pContext);
+}
+
+static void xInverse(sqlite3_context* pContext, int iCount, sqlite3_value** ppValues) {
+  jsInverse(sqlite3_user_data(pContext), pContext, iCount, ppValues);
+}
+
+// functionType is 0 for a scalar function, 1 for an aggregate function,
+// 2 for an aggregate window function, 3 for a scalar function with
+// decoded arguments, and 4 for a column aggregate.
+
 int EMSCRIPTEN_KEEPALIVE create_function(
   sqlite3* db,
   const char* zFunctionName,
@@ -25,13 +174,36 @@ int EMSCRIPTEN_KEEPALIVE create_function(
   int eTextRep,
   void* pApp,
   int functionType) {
+  if (functionType == 2) {
+    return sqlite3_create_window_function(
+      db,
+      zFunctionName,
+      nArg,
+      eTextRep,
+      pApp,
+      &xStep,
+      &xFinal,
+      &xValue,
+      &xInverse,
+      0);
+  }
   return sqlite3_create_function(
     db,
     zFunctionName,
     nArg,
     eTextRep,
     pApp,
-    functionType == 0 ? &xFunc : 0,
-    functionType == 0 ? 0 : &xStep,
-    functionType == 0 ? 0 : &xFinal);
+    functionType == 0 ? &xFunc : functionType == 3 ? &xFuncDecoded : 0,
+    functionType == 1 ? &xStep : functionType == 4 ? &xColumnStep : 0,
+    functionType == 1 ? &xFinal : functionType == 4 ? &xColumnFinal : 0);
+}
+
+// Function auxiliary data for Javascript is an id for a value kept in
+// Javascript. The value is released when SQLite discards the data.
+static void xAuxDataDelete(void* pAux) {
+  jsAuxDataDelete(pAux);
+}
+
+void EMSCRIPTEN_KEEPALIVE set_auxdata(sqlite3_context* pContext, int iArg, void* pAux) {
+  sqlite3_set_auxdata(pContext, iArg, pAux, &xAuxDataDelete);
 }
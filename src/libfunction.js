@@ -3,61 +3,171 @@
 const fn_methods = {
   $fn_method_support__postset: 'fn_method_support();',
   $fn_method_support: function() {
-    const mapIdToFunction = new Map();
-    const mapContextToAppData = new Map();
+    // Functions are stored densely, indexed by the key passed to SQLite
+    // as user data.
+    const functions = [];
+    const decoder = new TextDecoder();
+
+    // Auxiliary data values by id (see set_auxdata in libfunction.c).
+    const mapIdToAuxData = new Map();
+    let nextAuxDataId = 1;
+
+    function createFunction(db, zFunctionName, nArg, eTextRep, entry, functionType) {
+      const key = functions.length;
+      functions.push(entry);
+      return ccall(
+        'create_function',
+        'number',
+        ['number', 'string', 'number', 'number', 'number', 'number'],
+        [db, zFunctionName, nArg, eTextRep, key, functionType]);
+    }
 
     Module['createFunction'] =
       function(db, zFunctionName, nArg, eTextRep, pAppData, f) {
-        const key = mapIdToFunction.size;
-        mapIdToFunction.set(key, {
+        return createFunction(db, zFunctionName, nArg, eTextRep, {
           f: f,
           appData: pAppData
-        });
-        return ccall(
-          'create_function',
-          'number',
-          ['number', 'string', 'number', 'number', 'number', 'number'],
-          [db, zFunctionName, nArg, eTextRep, key, 0]);
+        }, 0);
+      }
+
+    Module['createFunctionDecoded'] =
+      function(db, zFunctionName, nArg, eTextRep, pAppData, f) {
+        return createFunction(db, zFunctionName, nArg, eTextRep, {
+          f: f,
+          appData: pAppData,
+          args: []
+        }, 3);
       }
 
     Module['createAggregate'] =
       function(db, zFunctionName, nArg, eTextRep, pAppData, fStep, fFinal) {
-        const key = mapIdToFunction.size;
-        mapIdToFunction.set(key, {
+        return createFunction(db, zFunctionName, nArg, eTextRep, {
           step: fStep,
           final: fFinal,
           appData: pAppData
-        });
-        return ccall(
-          'create_function',
-          'number',
-          ['number', 'string', 'number', 'number', 'number', 'number'],
-          [db, zFunctionName, nArg, eTextRep, key, 1]);
+        }, 1);
+      }
+
+    Module['createWindowFunction'] =
+      function(db, zFunctionName, nArg, eTextRep, pAppData, fStep, fFinal, fValue, fInverse) {
+        return createFunction(db, zFunctionName, nArg, eTextRep, {
+          step: fStep,
+          final: fFinal,
+          value: fValue,
+          inverse: fInverse,
+          appData: pAppData
+        }, 2);
+      }
+
+    Module['createColumnAggregate'] =
+      function(db, zFunctionName, nArg, eTextRep, pAppData, fFinal) {
+        return createFunction(db, zFunctionName, nArg, eTextRep, {
+          columnFinal: fFinal,
+          nArg: nArg,
+          appData: pAppData
+        }, 4);
       }
 
     Module['getFunctionUserData'] = function(pContext) {
-      return mapContextToAppData.get(pContext);
+      return functions[Module['_sqlite3_user_data'](pContext)].appData;
+    }
+
+    Module['getAuxData'] = function(pContext, iArg) {
+      const id = Module['_sqlite3_get_auxdata'](pContext, iArg);
+      return mapIdToAuxData.get(id);
+    }
+
+    Module['setAuxData'] = function(pContext, iArg, value) {
+      // Ids are 31-bit and never 0, which means no data.
+      const id = nextAuxDataId;
+      nextAuxDataId = (nextAuxDataId % 0x7fffffff) + 1;
+      mapIdToAuxData.set(id, value);
+      Module['_set_auxdata'](pContext, iArg, id);
+    }
+
+    // SQLite passes the same argument array on every row for a call
+    // site, so the view of it is kept and reused until the array or
+    // the WebAssembly memory buffer changes.
+    function getArgs(f, ppValues, iCount) {
+      const view = f.view;
+      if (view &&
+          view.byteOffset === ppValues &&
+          view.length === iCount &&
+          view.buffer === HEAP8.buffer) {
+        return view;
+      }
+      return f.view = new Uint32Array(HEAP8.buffer, ppValues, iCount);
     }
 
     _jsFunc = function(pApp, pContext, iCount, ppValues) {
-      const f = mapIdToFunction.get(pApp);
-      mapContextToAppData.set(pContext, f.appData);
-      f.f(pContext, new Uint32Array(HEAP8.buffer, ppValues, iCount));
-      mapContextToAppData.delete(pContext);
+      const f = functions[pApp];
+      f.f(pContext, getArgs(f, ppValues, iCount));
+    }
+
+    _jsFuncDecoded = function(pApp, pContext, iCount, pArgs) {
+      // Convert the values decoded by xFuncDecoded in libfunction.c.
+      // The argument array is reused for each call.
+      const f = functions[pApp];
+      const args = f.args;
+      args.length = iCount;
+      for (let i = 0; i < iCount; ++i) {
+        const p32 = (pArgs >> 2) + i * 4;
+        const nBytes = HEAP32[p32 + 1];
+        switch (HEAP32[p32]) {
+          case 1: // SQLITE_INTEGER
+          case 2: // SQLITE_FLOAT
+            args[i] = HEAPF64[(p32 + 2) >> 1];
+            break;
+          case 3: // SQLITE_TEXT
+            args[i] = decoder.decode(HEAPU8.subarray(HEAPU32[p32 + 2], HEAPU32[p32 + 2] + nBytes));
+            break;
+          case 4: // SQLITE_BLOB
+            args[i] = HEAP8.subarray(HEAPU32[p32 + 2], HEAPU32[p32 + 2] + nBytes);
+            break;
+          default:
+            args[i] = null;
+            break;
+        }
+      }
+      f.f(pContext, args);
     }
 
     _jsStep = function(pApp, pContext, iCount, ppValues) {
-      const f = mapIdToFunction.get(pApp);
-      mapContextToAppData.set(pContext, f.appData);
-      f.step(pContext, new Uint32Array(HEAP8.buffer, ppValues, iCount));
-      mapContextToAppData.delete(pContext);
+      const f = functions[pApp];
+      f.step(pContext, getArgs(f, ppValues, iCount));
     }
 
     _jsFinal = function(pApp, pContext) {
-      const f = mapIdToFunction.get(pApp);
-      mapContextToAppData.set(pContext, f.appData);
+      const f = functions[pApp];
       f.final(pContext);
-      mapContextToAppData.delete(pContext);
+    }
+
+    _jsValue = function(pApp, pContext) {
+      const f = functions[pApp];
+      f.value(pContext);
+    }
+
+    _jsInverse = function(pApp, pContext, iCount, ppValues) {
+      const f = functions[pApp];
+      f.inverse(pContext, getArgs(f, ppValues, iCount));
+    }
+
+    _jsColumnFinal = function(pApp, pContext, nRows, nStride, aValues) {
+      // Pass views of the column values collected by xColumnStep in
+      // libfunction.c. They are valid only during the call. A group
+      // with no rows gets empty columns.
+      const f = functions[pApp];
+      const columns = new Array(f.nArg);
+      for (let i = 0; i < f.nArg; ++i) {
+        columns[i] = HEAPF64.subarray(
+          (aValues >> 3) + i * nStride,
+          (aValues >> 3) + i * nStride + nRows);
+      }
+      f.columnFinal(pContext, columns);
+    }
+
+    _jsAuxDataDelete = function(pAux) {
+      mapIdToAuxData.delete(pAux);
     }
   }
 };
@@ -65,8 +175,13 @@ const fn_methods = {
 // @ts-ignore
 const FN_METHOD_NAMES = [
   "jsFunc",
+  "jsFuncDecoded",
   "jsStep",
-  "jsFinal"
+  "jsFinal",
+  "jsValue",
+  "jsInverse",
+  "jsAuxDataDelete",
+  "jsColumnFinal"
 ];
 for (const method of FN_METHOD_NAMES) {
   fn_methods[method] = function() {};
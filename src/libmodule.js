@@ -12,6 +12,22 @@ const mod_methods = {
     const closedVTabs = hasAsyncify ? new Set() : null;
     const closedCursors = hasAsyncify ? new Set() : null;
 
+    // 64-bit integers are accessed as two 32-bit halves so they are
+    // passed to modules as Number, as before BigInt builds. Setters also
+    // accept BigInt.
+    const getInt64 = ptr => HEAPU32[ptr >> 2] + HEAP32[(ptr >> 2) + 1] * 0x100000000;
+    const getUint64 = ptr => HEAPU32[ptr >> 2] + HEAPU32[(ptr >> 2) + 1] * 0x100000000;
+    const setInt64 = (ptr, v) => {
+      if (typeof v === 'bigint') {
+        HEAP32[ptr >> 2] = Number(BigInt.asIntN(32, v));
+        HEAP32[(ptr >> 2) + 1] = Number(BigInt.asIntN(32, v >> BigInt(32)));
+      } else {
+        v = Math.trunc(v);
+        HEAP32[ptr >> 2] = v;
+        HEAP32[(ptr >> 2) + 1] = Math.floor(v / 0x100000000);
+      }
+    };
+
     class Value {
       constructor(ptr, type) {
         this.ptr = ptr;
@@ -35,6 +51,9 @@ const mod_methods = {
           const p = this['allocate'](length + 1);
           stringToUTF8(v, p, length + 1);
           break;
+        case 'i64':
+          setInt64(this.ptr, v);
+          break;
         default:
           setValue(this.ptr, v, this.type);
           break;
@@ -84,9 +103,9 @@ const mod_methods = {
       struct['idxStr'] = null;
       struct['orderByConsumed'] = !!getValue(p + offset[8], 'i8');
       struct['estimatedCost'] = getValue(p + offset[9], 'double');
-      struct['estimatedRows'] = getValue(p + offset[10], 'i64');
+      struct['estimatedRows'] = getInt64(p + offset[10]);
       struct['idxFlags'] = getValue(p + offset[11], 'i32');
-      struct['colUsed'] = getValue(p + offset[12], 'i64');
+      struct['colUsed'] = getUint64(p + offset[12]);
       return struct;
     }
 
@@ -129,7 +148,7 @@ const mod_methods = {
       }
       setValue(p + offset[8], struct['orderByConsumed'], 'i32');
       setValue(p + offset[9], struct['estimatedCost'], 'double');
-      setValue(p + offset[10], struct['estimatedRows'], 'i64');
+      setInt64(p + offset[10], struct['estimatedRows']);
       setValue(p + offset[11], struct['idxFlags'], 'i32');
     }
 
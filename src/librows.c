@@ -0,0 +1,148 @@
+// Copyright 2022 Roy T. Hashimoto. All Rights Reserved.
+#include <emscripten.h>
+#include <sqlite3.h>
+#include <string.h>
+
+// Each value in the step_rows buffer is a header followed by a payload
+// padded to a multiple of 8 bytes. The payload is the value for FLOAT,
+// the 64-bit value as two 32-bit halves (low first) for INTEGER, the
+// UTF-8 bytes for TEXT, the bytes for BLOB, and empty for NULL. This
+// layout is decoded by sqlite3.step_rows() and encoded by
+// sqlite3.insert_many() in sqlite-api.js. TEXT and BLOB data pointers
+// are fetched before their size, as SQLite documents, here and in
+// libfunction.c.
+typedef struct RowValue {
+  int type;
+  int nBytes;
+} RowValue;
+
+static int reserve(char** ppBuffer, int* pnBuffer, int nRequired) {
+  if (nRequired <= *pnBuffer) return SQLITE_OK;
+
+  int nAlloc = *pnBuffer ? *pnBuffer : 4096;
+  while (nAlloc < nRequired) nAlloc *= 2;
+  char* pBuffer = (char*)sqlite3_realloc(*ppBuffer, nAlloc);
+  if (!pBuffer) return SQLITE_NOMEM;
+  *ppBuffer = pBuffer;
+  *pnBuffer = nAlloc;
+  return SQLITE_OK;
+}
+
+// Step a statement up to maxRows times, packing the values of each row
+// into a buffer in a single call from Javascript. The buffer is
+// allocated with sqlite3_malloc and is reused and grown as needed; the
+// caller owns it. Returns SQLITE_ROW if maxRows rows were packed,
+// SQLITE_DONE if the statement finished, or an error code.
+int EMSCRIPTEN_KEEPALIVE step_rows(
+  sqlite3_stmt* pStmt,
+  int maxRows,
+  char** ppBuffer,
+  int* pnBuffer,
+  int* pnRows) {
+  int nUsed = 0;
+  *pnRows = 0;
+  while (*pnRows < maxRows) {
+    const int rc = sqlite3_step(pStmt);
+    if (rc != SQLITE_ROW) return rc;
+
+    const int nColumns = sqlite3_data_count(pStmt);
+    for (int i = 0; i < nColumns; ++i) {
+      const int type = sqlite3_column_type(pStmt, i);
+      const void* pData = NULL;
+      int nBytes = 0;
+      switch (type) {
+        case SQLITE_INTEGER:
+        case SQLITE_FLOAT:
+          nBytes = 8;
+          break;
+        case SQLITE_TEXT:
+          pData = sqlite3_column_text(pStmt, i);
+          nBytes = sqlite3_column_bytes(pStmt, i);
+          break;
+        case SQLITE_BLOB:
+          pData = sqlite3_column_blob(pStmt, i);
+          nBytes = sqlite3_column_bytes(pStmt, i);
+          break;
+      }
+
+      const int nValue = sizeof(RowValue) + ((nBytes + 7) & ~7);
+      if (reserve(ppBuffer, pnBuffer, nUsed + nValue) != SQLITE_OK) {
+        return SQLITE_NOMEM;
+      }
+
+      RowValue* pValue = (RowValue*)(*ppBuffer + nUsed);
+      pValue->type = type;
+      pValue->nBytes = nBytes;
+      void* pPayload = pValue + 1;
+      switch (type) {
+        case SQLITE_INTEGER:
+          *(sqlite3_int64*)pPayload = sqlite3_column_int64(pStmt, i);
+          break;
+        case SQLITE_FLOAT:
+          *(double*)pPayload = sqlite3_column_double(pStmt, i);
+          break;
+        case SQLITE_TEXT:
+        case SQLITE_BLOB:
+          if (nBytes) memcpy(pPayload, pData, nBytes);
+          break;
+      }
+      nUsed += nValue;
+    }
+    ++*pnRows;
+  }
+  return SQLITE_ROW;
+}
+
+// Bind and execute a statement once for each of nRows rows of nColumns
+// values, packed in the same layout as step_rows. Values are bound to
+// parameters 1 to nColumns with SQLITE_STATIC, so the caller must clear
+// the bindings before releasing the buffer. Rows returned by the
+// statement are discarded. The number of rows executed is returned in
+// *pnDone. Returns SQLITE_OK if all rows were executed, otherwise an
+// error code with the statement reset.
+int EMSCRIPTEN_KEEPALIVE insert_many(
+  sqlite3_stmt* pStmt,
+  int nRows,
+  int nColumns,
+  const char* pBuffer,
+  int* pnDone) {
+  int rc = SQLITE_OK;
+  *pnDone = 0;
+  while (*pnDone < nRows) {
+    for (int i = 0; i < nColumns && rc == SQLITE_OK; ++i) {
+      const RowValue* pValue = (const RowValue*)pBuffer;
+      const void* pPayload = pValue + 1;
+      switch (pValue->type) {
+        case SQLITE_INTEGER:
+          rc = sqlite3_bind_int64(pStmt, i + 1, *(const sqlite3_int64*)pPayload);
+          break;
+        case SQLITE_FLOAT:
+          rc = sqlite3_bind_double(pStmt, i + 1, *(const double*)pPayload);
+          break;
+        case SQLITE_TEXT:
+          rc = sqlite3_bind_text(
+            pStmt, i + 1, (const char*)pPayload, pValue->nBytes, SQLITE_STATIC);
+          break;
+        case SQLITE_BLOB:
+          rc = sqlite3_bind_blob(
+            pStmt, i + 1, pPayload, pValue->nBytes, SQLITE_STATIC);
+          break;
+        default:
+          rc = sqlite3_bind_null(pStmt, i + 1);
+          break;
+      }
+      pBuffer += sizeof(RowValue) + ((pValue->nBytes + 7) & ~7);
+    }
+    if (rc != SQLITE_OK) return rc;
+
+    while ((rc = sqlite3_step(pStmt)) == SQLITE_ROW);
+    if (rc != SQLITE_DONE) {
+      sqlite3_reset(pStmt);
+      return rc;
+    }
+    rc = sqlite3_reset(pStmt);
+    if (rc != SQLITE_OK) return rc;
+    ++*pnDone;
+  }
+  return SQLITE_OK;
+}
@@ -2,6 +2,7 @@
 #include <sys/time.h>
 #include <emscripten.h>
 #include <sqlite3.h>
+#include <stddef.h>
 #include <string.h>
 
 // sqlite3_io_methods javascript handlers
@@ -9,6 +10,8 @@
 extern int vfsClose(sqlite3_file* file);
 extern int vfsRead(sqlite3_file* file, void* pData, int iAmt, const sqlite3_int64* iOffset);
 extern int vfsWrite(sqlite3_file* file, const void* pData, int iAmt, const sqlite3_int64* iOffset);
+extern int vfsWriteBatch(sqlite3_file* file, int nWrites, const void* pWrites);
+extern int vfsReadAhead(sqlite3_file* file, const sqlite3_int64* iOffset, int iAmt);
 extern int vfsTruncate(sqlite3_file* file, const sqlite3_int64* size);
 extern int vfsSync(sqlite3_file* file, int flags);
 extern int vfsFileSize(sqlite3_file* file, sqlite3_int64* pSize);
@@ -18,40 +21,544 @@ extern int vfsCheckReservedLock(sqlite3_file* file, int* pResOut);
 extern int vfsFileControl(sqlite3_file* file, int flags, void* pOut);
 extern int vfsSectorSize(sqlite3_file* file);
 extern int vfsDeviceCharacteristics(sqlite3_file* file);
+extern int vfsShmMap(sqlite3_file* file, int iPg, int pgsz, int bExtend, void* pData);
+extern int vfsShmLock(sqlite3_file* file, int offset, int n, int flags);
+extern void vfsShmBarrier(sqlite3_file* file);
+extern int vfsShmUnmap(sqlite3_file* file, int deleteFlag);
+extern int vfsFetch(sqlite3_file* file, const sqlite3_int64* iOffset, int iAmt, void** pp);
+extern int vfsUnfetch(sqlite3_file* file, const sqlite3_int64* iOffset, void* p);
 
 extern int vfsOpen(sqlite3_vfs* vfs, const char *zName, sqlite3_file* file, int flags, int *pOutFlags);
 extern int vfsDelete(sqlite3_vfs* vfs, const char *zName, int syncDir);
 extern int vfsAccess(sqlite3_vfs* vfs, const char *zName, int flags, int *pResOut);
 
-// Glue functions to pass 64-bit integers by pointer.
+// Javascript VFS flags. Most bits indicate which optional methods are
+// implemented (see Module.registerVFS in libvfs.js).
+#define VFS_FLAG_SHM_MAP      (1 << 0)
+#define VFS_FLAG_SHM_LOCK     (1 << 1)
+#define VFS_FLAG_SHM_BARRIER  (1 << 2)
+#define VFS_FLAG_SHM_UNMAP    (1 << 3)
+#define VFS_FLAG_FETCH        (1 << 4)
+#define VFS_FLAG_UNFETCH      (1 << 5)
+#define VFS_FLAG_CACHE_SIZE   (1 << 6)
+#define VFS_FLAG_SYNC         (1 << 7)
+#define VFS_FLAG_LOCK         (1 << 8)
+#define VFS_FLAG_UNLOCK       (1 << 9)
+#define VFS_FLAG_CHECK_LOCK   (1 << 10)
+#define VFS_FLAG_SECTOR_SIZE  (1 << 11)
+#define VFS_FLAG_DEVICE_CHARS (1 << 12)
+#define VFS_FLAG_FILE_CONTROL (1 << 13)
+#define VFS_FLAG_WRITE_BATCH  (1 << 14)
+#define VFS_FLAG_READ_AHEAD   (1 << 15)
+
+// Buffered writes are flushed when the buffer would exceed this size.
+#define VFS_BATCH_LIMIT (4 * 1024 * 1024)
+
+// A read-ahead hint covers this many reads of the current size, up to
+// a maximum number of bytes.
+#define VFS_READ_AHEAD_COUNT 32
+#define VFS_READ_AHEAD_LIMIT (1024 * 1024)
+
+typedef struct VFS {
+  sqlite3_vfs base;
+  int flags;
+  int iVfs;
+  sqlite3_io_methods methods;
+} VFS;
+
+// Shared memory for the WAL index. This is kept in the WebAssembly heap
+// and is shared by all connections to the same database within this
+// module instance. It is not shared with other contexts (e.g. other
+// tabs or workers).
+typedef struct VFSShmNode VFSShmNode;
+struct VFSShmNode {
+  VFS* pVfs;
+  char* zName;
+  int nRef;
+  int szRegion;
+  int nRegion;
+  char** apRegion;
+
+  // Lock state for each slot: 0 = unlocked, >0 = number of shared
+  // locks, -1 = exclusive.
+  int aLock[SQLITE_SHM_NLOCK];
+  VFSShmNode* pNext;
+};
+static VFSShmNode* pShmNodeList = NULL;
+
+typedef struct VFSFile {
+  sqlite3_file base;
+
+  // These fields are read by libvfs.js so their offsets must not change.
+  int iVfs;           // index of the Javascript VFS
+  void* pFileData;    // bytes reserved for the Javascript VFS
+
+  VFS* pVfs;
+  const char* zName;
+
+  // Values answered without calling Javascript.
+  int eLock;                  // lock level last set by xLock or xUnlock
+  int sectorSize;             // -1 if not yet known
+  int deviceCharacteristics;  // -1 if not yet known
+  int bCacheSize;             // database files of a VFS with cacheFileSize
+  int bSizeValid;
+  sqlite3_int64 iSize;
+
+  // Shared memory state.
+  VFSShmNode* pShmNode;
+  unsigned short shmSharedMask;
+  unsigned short shmExclMask;
+
+  // Writes not yet passed to Javascript, for a VFS with xWriteBatch.
+  // Each write is a VFSBatchWrite header followed by the data, padded
+  // to a multiple of 8 bytes.
+  char* aBatch;
+  int nBatch;       // bytes used
+  int nBatchAlloc;  // bytes allocated
+  int nBatchWrites;
+
+  // Sequential read detection, for a VFS with xReadAhead.
+  sqlite3_int64 iReadEnd;       // end of the previous read
+  sqlite3_int64 iReadAheadEnd;  // end of the last read-ahead hint
+} VFSFile;
+_Static_assert(offsetof(VFSFile, iVfs) == 4, "VFSFile layout");
+_Static_assert(offsetof(VFSFile, pFileData) == 8, "VFSFile layout");
+
+// The Javascript VFS bytes follow VFSFile, 8-byte aligned.
+#define VFS_FILE_DATA_OFFSET ((sizeof(VFSFile) + 7) & ~7)
+
+// Batched write header. This layout is read by libvfs.js.
+typedef struct VFSBatchWrite {
+  sqlite3_int64 iOffset;
+  int iAmt;
+  int reserved;
+} VFSBatchWrite;
+_Static_assert(sizeof(VFSBatchWrite) == 16, "VFSBatchWrite layout");
+
+// Pass buffered writes to Javascript. This must be called before any
+// other call to Javascript for the file so that the Javascript VFS
+// sees operations in the order SQLite made them. The one exception is
+// xShmBarrier, which cannot return an error, so a failed flush there
+// would lose the writes; the barrier only orders access to shared
+// memory, which is kept in C, and the writes are passed at the next
+// call that can fail.
+static int flushWrites(VFSFile* p) {
+  if (!p->nBatchWrites) return SQLITE_OK;
+  const int rc = vfsWriteBatch((sqlite3_file*)p, p->nBatchWrites, p->aBatch);
+  p->nBatch = 0;
+  p->nBatchWrites = 0;
+  if (rc != SQLITE_OK) p->bSizeValid = 0;
+  return rc;
+}
+
+static int bufferWrite(VFSFile* p, const void* pData, int iAmt, sqlite3_int64 iOffset) {
+  const int nRecord = sizeof(VFSBatchWrite) + ((iAmt + 7) & ~7);
+  if (p->nBatch && p->nBatch + nRecord > VFS_BATCH_LIMIT) {
+    const int rc = flushWrites(p);
+    if (rc != SQLITE_OK) return rc;
+  }
+
+  if (p->nBatch + nRecord > p->nBatchAlloc) {
+    int nAlloc = p->nBatchAlloc ? p->nBatchAlloc * 2 : 65536;
+    while (nAlloc < p->nBatch + nRecord) nAlloc *= 2;
+    char* aBatch = (char*)sqlite3_realloc(p->aBatch, nAlloc);
+    if (!aBatch) return SQLITE_NOMEM;
+    p->aBatch = aBatch;
+    p->nBatchAlloc = nAlloc;
+  }
+
+  VFSBatchWrite* pWrite = (VFSBatchWrite*)(p->aBatch + p->nBatch);
+  pWrite->iOffset = iOffset;
+  pWrite->iAmt = iAmt;
+  pWrite->reserved = 0;
+  memcpy(pWrite + 1, pData, iAmt);
+  p->nBatch += nRecord;
+  p->nBatchWrites++;
+  return SQLITE_OK;
+}
+
+#define FLUSH_WRITES(p) do { \
+  const int rcFlush = flushWrites(p); \
+  if (rcFlush != SQLITE_OK) return rcFlush; \
+} while (0)
+
+// Glue functions to pass 64-bit integers by pointer. These also
+// maintain the cached file size, if enabled.
 static int xRead(sqlite3_file* file, void* pData, int iAmt, sqlite3_int64 iOffset) {
+  VFSFile* p = (VFSFile*)file;
+  FLUSH_WRITES(p);
+  if (p->pVfs->flags & VFS_FLAG_READ_AHEAD) {
+    // When a read continues from the previous read and is not covered by
+    // the last hint, tell Javascript which data will likely be read next.
+    // The hint result is ignored because xRead is still called.
+    if (iOffset == p->iReadEnd && iOffset + iAmt > p->iReadAheadEnd) {
+      int nAhead = iAmt * VFS_READ_AHEAD_COUNT;
+      if (nAhead > VFS_READ_AHEAD_LIMIT) nAhead = VFS_READ_AHEAD_LIMIT;
+      if (nAhead < iAmt) nAhead = iAmt;
+      vfsReadAhead(file, &iOffset, nAhead);
+      p->iReadAheadEnd = iOffset + nAhead;
+    }
+    p->iReadEnd = iOffset + iAmt;
+  }
   return vfsRead(file, pData, iAmt, &iOffset);
 }
 static int xWrite(sqlite3_file* file, const void* pData, int iAmt, sqlite3_int64 iOffset) {
-  return vfsWrite(file, pData, iAmt, &iOffset);
+  VFSFile* p = (VFSFile*)file;
+  p->iReadAheadEnd = 0;
+  const int rc = (p->pVfs->flags & VFS_FLAG_WRITE_BATCH) ?
+    bufferWrite(p, pData, iAmt, iOffset) :
+    vfsWrite(file, pData, iAmt, &iOffset);
+  if (rc == SQLITE_OK) {
+    if (p->bSizeValid && p->iSize < iOffset + iAmt) p->iSize = iOffset + iAmt;
+  } else {
+    p->bSizeValid = 0;
+  }
+  return rc;
 }
 static int xTruncate(sqlite3_file* file, sqlite3_int64 size) {
+  FLUSH_WRITES((VFSFile*)file);
+  ((VFSFile*)file)->bSizeValid = 0;
+  ((VFSFile*)file)->iReadAheadEnd = 0;
   return vfsTruncate(file, &size);
 }
+static int xFetch(sqlite3_file* file, sqlite3_int64 iOffset, int iAmt, void** pp) {
+  FLUSH_WRITES((VFSFile*)file);
+  return vfsFetch(file, &iOffset, iAmt, pp);
+}
+static int xUnfetch(sqlite3_file* file, sqlite3_int64 iOffset, void* p) {
+  if (((VFSFile*)file)->pVfs->flags & VFS_FLAG_UNFETCH) {
+    FLUSH_WRITES((VFSFile*)file);
+    return vfsUnfetch(file, &iOffset, p);
+  }
+  return SQLITE_OK;
+}
+
+static VFSShmNode* shmNodeAcquire(VFS* pVfs, const char* zName) {
+  VFSShmNode* pNode;
+  for (pNode = pShmNodeList; pNode; pNode = pNode->pNext) {
+    if (pNode->pVfs == pVfs && !strcmp(pNode->zName, zName)) {
+      break;
+    }
+  }
+
+  if (!pNode) {
+    pNode = (VFSShmNode*)sqlite3_malloc(sizeof(VFSShmNode));
+    if (!pNode) return NULL;
+    memset(pNode, 0, sizeof(VFSShmNode));
+    pNode->zName = sqlite3_mprintf("%s", zName);
+    if (!pNode->zName) {
+      sqlite3_free(pNode);
+      return NULL;
+    }
+    pNode->pVfs = pVfs;
+    pNode->pNext = pShmNodeList;
+    pShmNodeList = pNode;
+  }
+  ++pNode->nRef;
+  return pNode;
+}
+
+static void shmNodeRelease(VFSShmNode* pNode) {
+  if (--pNode->nRef) return;
+
+  VFSShmNode** pp = &pShmNodeList;
+  while (*pp != pNode) pp = &(*pp)->pNext;
+  *pp = pNode->pNext;
+
+  for (int i = 0; i < pNode->nRegion; ++i) {
+    sqlite3_free(pNode->apRegion[i]);
+  }
+  sqlite3_free(pNode->apRegion);
+  sqlite3_free(pNode->zName);
+  sqlite3_free(pNode);
+}
+
+static int xShmMap(sqlite3_file* pFile, int iPg, int pgsz, int bExtend, void volatile** pp) {
+  VFSFile* p = (VFSFile*)pFile;
+  if (!p->pShmNode) {
+    p->pShmNode = shmNodeAcquire(p->pVfs, p->zName);
+    if (!p->pShmNode) return SQLITE_NOMEM;
+  }
+
+  VFSShmNode* pNode = p->pShmNode;
+  if (pNode->nRegion && pNode->szRegion != pgsz) return SQLITE_IOERR_SHMSIZE;
+  pNode->szRegion = pgsz;
+
+  if (iPg >= pNode->nRegion) {
+    if (!bExtend) {
+      *pp = NULL;
+      return SQLITE_OK;
+    }
+
+    char** apRegion = (char**)sqlite3_realloc(pNode->apRegion, (iPg + 1) * sizeof(char*));
+    if (!apRegion) return SQLITE_NOMEM;
+    pNode->apRegion = apRegion;
+    while (pNode->nRegion <= iPg) {
+      char* pRegion = (char*)sqlite3_malloc(pgsz);
+      if (!pRegion) return SQLITE_NOMEM;
+      memset(pRegion, 0, pgsz);
+      pNode->apRegion[pNode->nRegion++] = pRegion;
+    }
+  }
+  *pp = pNode->apRegion[iPg];
+
+  // Notify Javascript, e.g. so the region contents can be initialized.
+  FLUSH_WRITES(p);
+  return vfsShmMap(pFile, iPg, pgsz, bExtend, (void*)*pp);
+}
+
+// Update the in-heap lock state only.
+static int shmLockLocal(VFSFile* p, int offset, int n, int flags) {
+  VFSShmNode* pNode = p->pShmNode;
+  const unsigned short mask = (1 << (offset + n)) - (1 << offset);
+  if (flags & SQLITE_SHM_UNLOCK) {
+    for (int i = offset; i < offset + n; ++i) {
+      if (p->shmExclMask & (1 << i)) {
+        pNode->aLock[i] = 0;
+      } else if (p->shmSharedMask & (1 << i)) {
+        --pNode->aLock[i];
+      }
+    }
+    p->shmSharedMask &= ~mask;
+    p->shmExclMask &= ~mask;
+  } else if (flags & SQLITE_SHM_SHARED) {
+    // A shared lock starts a WAL read transaction, after which the
+    // database file may have been changed by a checkpoint.
+    p->bSizeValid = 0;
+    if (pNode->aLock[offset] < 0) return SQLITE_BUSY;
+    ++pNode->aLock[offset];
+    p->shmSharedMask |= mask;
+  } else {
+    for (int i = offset; i < offset + n; ++i) {
+      if (pNode->aLock[i]) return SQLITE_BUSY;
+    }
+    for (int i = offset; i < offset + n; ++i) {
+      pNode->aLock[i] = -1;
+    }
+    p->shmExclMask |= mask;
+  }
+  return SQLITE_OK;
+}
+
+static int xShmLock(sqlite3_file* pFile, int offset, int n, int flags) {
+  VFSFile* p = (VFSFile*)pFile;
+  if (!p->pShmNode) return SQLITE_IOERR_SHMLOCK;
+
+  // Nothing to do if this connection already holds the requested lock.
+  const unsigned short mask = (1 << (offset + n)) - (1 << offset);
+  if ((flags & SQLITE_SHM_SHARED) && (p->shmSharedMask & mask) == mask) {
+    return SQLITE_OK;
+  }
+  if ((flags & SQLITE_SHM_EXCLUSIVE) && (p->shmExclMask & mask) == mask) {
+    return SQLITE_OK;
+  }
+
+  if (p->pVfs->flags & VFS_FLAG_SHM_LOCK) FLUSH_WRITES(p);
+  int rc = shmLockLocal(p, offset, n, flags);
+  if (rc == SQLITE_OK && (p->pVfs->flags & VFS_FLAG_SHM_LOCK)) {
+    // Javascript may veto the lock, e.g. to coordinate with other contexts.
+    rc = vfsShmLock(pFile, offset, n, flags);
+    if (rc != SQLITE_OK && !(flags & SQLITE_SHM_UNLOCK)) {
+      shmLockLocal(p, offset, n, SQLITE_SHM_UNLOCK);
+    }
+  }
+  return rc;
+}
+
+static void xShmBarrier(sqlite3_file* pFile) {
+  VFSFile* p = (VFSFile*)pFile;
+  if (p->pVfs->flags & VFS_FLAG_SHM_BARRIER) {
+    vfsShmBarrier(pFile);
+  }
+}
+
+static int xShmUnmap(sqlite3_file* pFile, int deleteFlag) {
+  VFSFile* p = (VFSFile*)pFile;
+  if (!p->pShmNode) return SQLITE_OK;
+
+  // Release any locks still held.
+  shmLockLocal(p, 0, SQLITE_SHM_NLOCK, SQLITE_SHM_UNLOCK);
+  shmNodeRelease(p->pShmNode);
+  p->pShmNode = NULL;
+
+  if (p->pVfs->flags & VFS_FLAG_SHM_UNMAP) {
+    FLUSH_WRITES(p);
+    return vfsShmUnmap(pFile, deleteFlag);
+  }
+  return SQLITE_OK;
+}
+
+static int xClose(sqlite3_file* pFile) {
+  VFSFile* p = (VFSFile*)pFile;
+  int rc = flushWrites(p);
+  sqlite3_free(p->aBatch);
+  p->aBatch = NULL;
+  p->nBatchAlloc = 0;
+
+  xShmUnmap(pFile, 0);
+  const int rcClose = vfsClose(pFile);
+  return rc == SQLITE_OK ? rcClose : rc;
+}
+
+// Methods that the Javascript VFS may omit, or whose results can be
+// cached, are answered here when possible to avoid calling Javascript.
+static int xSync(sqlite3_file* file, int flags) {
+  VFSFile* p = (VFSFile*)file;
+  FLUSH_WRITES(p);
+  if (p->pVfs->flags & VFS_FLAG_SYNC) {
+    return vfsSync(file, flags);
+  }
+  return SQLITE_OK;
+}
+
+static int xFileSize(sqlite3_file* file, sqlite3_int64* pSize) {
+  VFSFile* p = (VFSFile*)file;
+  if (p->bSizeValid) {
+    *pSize = p->iSize;
+    return SQLITE_OK;
+  }
+
+  FLUSH_WRITES(p);
+  const int rc = vfsFileSize(file, pSize);
+  if (rc == SQLITE_OK && p->bCacheSize) {
+    p->iSize = *pSize;
+    p->bSizeValid = 1;
+  }
+  return rc;
+}
+
+static int xLock(sqlite3_file* file, int flags) {
+  VFSFile* p = (VFSFile*)file;
+
+  // Another connection may have changed the file since we last held a
+  // lock, so the cached size and any read-ahead data may be stale.
+  p->bSizeValid = 0;
+  p->iReadAheadEnd = 0;
+  FLUSH_WRITES(p);
+  if (p->pVfs->flags & VFS_FLAG_LOCK) {
+    const int rc = vfsLock(file, flags);
+    if (rc != SQLITE_OK) return rc;
+  }
+  p->eLock = flags;
+  return SQLITE_OK;
+}
+
+static int xUnlock(sqlite3_file* file, int flags) {
+  VFSFile* p = (VFSFile*)file;
+  FLUSH_WRITES(p);
+  if (p->pVfs->flags & VFS_FLAG_UNLOCK) {
+    const int rc = vfsUnlock(file, flags);
+    if (rc != SQLITE_OK) return rc;
+  }
+  p->eLock = flags;
+  return SQLITE_OK;
+}
+
+static int xCheckReservedLock(sqlite3_file* file, int* pResOut) {
+  VFSFile* p = (VFSFile*)file;
+
+  // A reserved or greater lock held through this file answers the
+  // question without asking Javascript.
+  if (p->eLock >= SQLITE_LOCK_RESERVED) {
+    *pResOut = 1;
+    return SQLITE_OK;
+  }
+
+  if (p->pVfs->flags & VFS_FLAG_CHECK_LOCK) {
+    FLUSH_WRITES(p);
+    return vfsCheckReservedLock(file, pResOut);
+  }
+  *pResOut = 0;
+  return SQLITE_OK;
+}
+
+static int xFileControl(sqlite3_file* file, int op, void* pArg) {
+  VFSFile* p = (VFSFile*)file;
+  if (!(p->pVfs->flags & VFS_FLAG_FILE_CONTROL)) return SQLITE_NOTFOUND;
+
+  // Buffered writes are flushed before every file control so, e.g.,
+  // the writes of a batch atomic transaction reach Javascript before
+  // SQLITE_FCNTL_COMMIT_ATOMIC_WRITE.
+  FLUSH_WRITES(p);
+  const int rc = vfsFileControl(file, op, pArg);
+  if (rc != SQLITE_NOTFOUND) {
+    // The Javascript VFS may have changed the file, e.g. on rollback
+    // of a batch atomic write.
+    p->bSizeValid = 0;
+    p->iReadAheadEnd = 0;
+  }
+  return rc;
+}
+
+// Sector size and device characteristics are assumed constant for an
+// open file, so Javascript is called at most once for each.
+static int xSectorSize(sqlite3_file* file) {
+  VFSFile* p = (VFSFile*)file;
+  if (p->sectorSize < 0) {
+    p->sectorSize = (p->pVfs->flags & VFS_FLAG_SECTOR_SIZE) ? vfsSectorSize(file) : 0;
+  }
+  return p->sectorSize;
+}
+
+static int xDeviceCharacteristics(sqlite3_file* file) {
+  VFSFile* p = (VFSFile*)file;
+  if (p->deviceCharacteristics < 0) {
+    p->deviceCharacteristics = (p->pVfs->flags & VFS_FLAG_DEVICE_CHARS) ?
+      vfsDeviceCharacteristics(file) : 0;
+  }
+  return p->deviceCharacteristics;
+}
+
+// Reassemble a URI filename, whose query parameters follow the path as
+// null-terminated key and value strings, into a single string. The
+// result must be freed with sqlite3_free().
+static char* uriFilename(const char* zName) {
+  sqlite3_str* pStr = sqlite3_str_new(NULL);
+  sqlite3_str_appendall(pStr, zName);
+
+  const char* zKey;
+  for (int i = 0; (zKey = sqlite3_uri_key(zName, i)); ++i) {
+    // Each value immediately follows its key.
+    const char* zValue = zKey + strlen(zKey) + 1;
+    sqlite3_str_appendf(pStr, "%c%s=%s", i ? '&' : '?', zKey, zValue);
+  }
+  return sqlite3_str_finish(pStr);
+}
 
 static int xOpen(sqlite3_vfs* vfs, const char* zName, sqlite3_file* file, int flags, int* pOutFlags) {
-  static sqlite3_io_methods io_methods = {
-    1,
-    vfsClose,
-    xRead,
-    xWrite,
-    xTruncate,
-    vfsSync,
-    vfsFileSize,
-    vfsLock,
-    vfsUnlock,
-    vfsCheckReservedLock,
-    vfsFileControl,
-    vfsSectorSize,
-    vfsDeviceCharacteristics
-  };
-  file->pMethods = &io_methods;
+  VFSFile* p = (VFSFile*)file;
+  p->iVfs = ((VFS*)vfs)->iVfs;
+  p->pFileData = (char*)file + VFS_FILE_DATA_OFFSET;
+  p->pVfs = (VFS*)vfs;
+  p->zName = zName;
+  p->eLock = SQLITE_LOCK_NONE;
+  p->sectorSize = -1;
+  p->deviceCharacteristics = -1;
+  // Only database file sizes are cached. Their cache is invalidated
+  // on each lock, but a WAL or journal file can be changed by another
+  // connection while this one holds a lock on the database.
+  p->bCacheSize = (p->pVfs->flags & VFS_FLAG_CACHE_SIZE) &&
+    (flags & (SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_TEMP_DB));
+  p->bSizeValid = 0;
+  p->pShmNode = NULL;
+  p->shmSharedMask = 0;
+  p->shmExclMask = 0;
+  p->aBatch = NULL;
+  p->nBatch = 0;
+  p->nBatchAlloc = 0;
+  p->nBatchWrites = 0;
+  p->iReadEnd = -1;
+  p->iReadAheadEnd = 0;
+  file->pMethods = &p->pVfs->methods;
 
+  // Javascript gets the complete name as a single string.
+  if (zName && (flags & SQLITE_OPEN_URI)) {
+    char* zUri = uriFilename(zName);
+    if (!zUri) return SQLITE_NOMEM;
+    const int rc = vfsOpen(vfs, zUri, file, flags, pOutFlags);
+    sqlite3_free(zUri);
+    return rc;
+  }
   return vfsOpen(vfs, zName, file, flags, pOutFlags);
 }
 
@@ -73,15 +580,55 @@ static int xCurrentTime(sqlite3_vfs* vfs, double* pJulianDay) {
 const int EMSCRIPTEN_KEEPALIVE register_vfs(
   const char* zName,
   int mxPathName,
+  int szFileData,
+  int flags,
+  int iVfs,
   int makeDefault,
   sqlite3_vfs** ppVFS) {
-  sqlite3_vfs* vfs = *ppVFS = (sqlite3_vfs*)sqlite3_malloc(sizeof(sqlite3_vfs));
+  VFS* pVfs = (VFS*)sqlite3_malloc(sizeof(VFS));
+  sqlite3_vfs* vfs = *ppVFS = (sqlite3_vfs*)pVfs;
   if (!vfs) {
     return SQLITE_NOMEM;
   }
+  pVfs->flags = flags;
+  pVfs->iVfs = iVfs;
+
+  // The io_methods version depends on the optional methods provided
+  // by the Javascript VFS. Shared memory methods (for WAL) use an
+  // in-heap implementation so WAL should not be enabled on a VFS that
+  // can be accessed from multiple contexts simultaneously (unless it
+  // provides its own coordination). Memory-mapped I/O methods are only
+  // useful for a VFS that keeps file data in the WebAssembly heap.
+  sqlite3_io_methods* methods = &pVfs->methods;
+  memset(methods, 0, sizeof(sqlite3_io_methods));
+  methods->iVersion = 1;
+  methods->xClose = xClose;
+  methods->xRead = xRead;
+  methods->xWrite = xWrite;
+  methods->xTruncate = xTruncate;
+  methods->xSync = xSync;
+  methods->xFileSize = xFileSize;
+  methods->xLock = xLock;
+  methods->xUnlock = xUnlock;
+  methods->xCheckReservedLock = xCheckReservedLock;
+  methods->xFileControl = xFileControl;
+  methods->xSectorSize = xSectorSize;
+  methods->xDeviceCharacteristics = xDeviceCharacteristics;
+  if (flags & VFS_FLAG_SHM_MAP) {
+    methods->iVersion = 2;
+    methods->xShmMap = xShmMap;
+    methods->xShmLock = xShmLock;
+    methods->xShmBarrier = xShmBarrier;
+    methods->xShmUnmap = xShmUnmap;
+  }
+  if (flags & VFS_FLAG_FETCH) {
+    methods->iVersion = 3;
+    methods->xFetch = xFetch;
+    methods->xUnfetch = xUnfetch;
+  }
 
   vfs->iVersion = 1;
-  vfs->szOsFile = sizeof(sqlite3_file);
+  vfs->szOsFile = VFS_FILE_DATA_OFFSET + szFileData;
   vfs->mxPathname = mxPathName;
   vfs->pNext = NULL;
   vfs->zName = strdup(zName);
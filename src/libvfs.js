@@ -4,8 +4,31 @@ const vfs_methods = {
   $vfs_method_support: function() {
     const hasAsyncify = typeof Asyncify === 'object';
 
+    // Tell the Javascript API whether calls into WebAssembly can suspend,
+    // i.e. whether this is an Asyncify or JSPI build.
+    Module['isAsync'] = hasAsyncify;
+
+    // VFS objects are found by sqlite3_vfs pointer for sqlite3_vfs
+    // methods, and by an index stored in the sqlite3_file extension for
+    // sqlite3_io_methods methods (see VFSFile in libvfs.c).
     const mapIdToVFS = new Map();
-    const mapFileToVFS = new Map();
+    const vfsList = [];
+    const getVFS = file => vfsList[HEAP32[(file + 4) >> 2]];
+    const getFileData = file => HEAP32[(file + 8) >> 2];
+
+    // Heap access for a VFS that keeps file data in WebAssembly memory,
+    // e.g. to support xFetch. The typed arrays are getters because they
+    // are replaced when memory grows.
+    const heap = {
+      'malloc': size => Module['_malloc'](size),
+      'free': ptr => Module['_free'](ptr)
+    };
+    Object.defineProperty(heap, 'HEAP8', { get: () => HEAP8 });
+    Object.defineProperty(heap, 'HEAPU8', { get: () => HEAPU8 });
+
+    // True if a VFS defines a method other than a VFS.Base default that
+    // C handles the same way without calling Javascript.
+    const overrides = (vfs, name) => vfs[name] && !vfs[name]['isDefault'];
 
     Module['registerVFS'] = function(vfs, makeDefault) {
       const vfsAlreadyRegistered = ccall('sqlite3_vfs_find', 'number', ['string'],
@@ -19,173 +42,258 @@ const vfs_methods = {
         vfs['handleAsync'] = Asyncify.handleAsync;
       }
 
+      // Inject WebAssembly heap access.
+      vfs['heap'] = heap;
+      vfs['fileData'] = getFileData;
+
+      // Set bits for the provided optional functions.
+      let flags = 0;
+      if (vfs['xShmMap']) flags |= 1 << 0;
+      if (vfs['xShmLock']) flags |= 1 << 1;
+      if (vfs['xShmBarrier']) flags |= 1 << 2;
+      if (vfs['xShmUnmap']) flags |= 1 << 3;
+      if (vfs['xFetch']) flags |= 1 << 4;
+      if (vfs['xUnfetch']) flags |= 1 << 5;
+      if (vfs['cacheFileSize']) flags |= 1 << 6;
+      if (overrides(vfs, 'xSync')) flags |= 1 << 7;
+      if (overrides(vfs, 'xLock')) flags |= 1 << 8;
+      if (overrides(vfs, 'xUnlock')) flags |= 1 << 9;
+      if (overrides(vfs, 'xCheckReservedLock')) flags |= 1 << 10;
+      if (overrides(vfs, 'xSectorSize')) flags |= 1 << 11;
+      if (overrides(vfs, 'xDeviceCharacteristics')) flags |= 1 << 12;
+      if (overrides(vfs, 'xFileControl')) flags |= 1 << 13;
+      if (vfs['xWriteBatch']) flags |= 1 << 14;
+      if (vfs['xReadAhead']) flags |= 1 << 15;
+
       const mxPathName = vfs.mxPathName ?? 64;
+      const szFileData = vfs['fileDataSize'] ?? 0;
       const out = Module['_malloc'](4);
-      const result = ccall('register_vfs', 'number', ['string', 'number', 'number', 'number'],
-        [vfs.name, mxPathName, makeDefault ? 1 : 0, out]);
+      const result = ccall('register_vfs', 'number',
+        ['string', 'number', 'number', 'number', 'number', 'number', 'number'],
+        [vfs.name, mxPathName, szFileData, flags, vfsList.length, makeDefault ? 1 : 0, out]);
       if (!result) {
         const id = getValue(out, 'i32');
         mapIdToVFS.set(id, vfs);
+        vfsList.push(vfs);
       }
       Module['_free'](out);
       return result;
     };
 
-    const closedFiles = hasAsyncify ? new Set() : null;
+    // 64-bit integers are accessed as two 32-bit halves. Values are
+    // limited to the safe integer range.
+    const getInt64 = ptr => HEAPU32[ptr >> 2] + HEAP32[(ptr >> 2) + 1] * 0x100000000;
+    const setInt64 = (ptr, v) => {
+      HEAP32[ptr >> 2] = v;
+      HEAP32[(ptr >> 2) + 1] = Math.floor(v / 0x100000000);
+    };
+
+    // Typed array views into the heap are cached by address because
+    // SQLite reuses its page buffers. The cache is discarded when memory
+    // grows and the heap buffer is replaced. The cache has
+    // 2^VIEW_CACHE_BITS slots indexed by a multiplicative hash.
+    const VIEW_CACHE_BITS = 8;
+    const viewCache = [];
+    let viewCacheBuffer = null;
+    function getView(ptr, size) {
+      if (viewCacheBuffer !== HEAP8.buffer) {
+        viewCache.length = 0;
+        viewCacheBuffer = HEAP8.buffer;
+      }
+
+      const index = Math.imul(ptr, 0x9e3779b1) >>> (32 - VIEW_CACHE_BITS);
+      let view = viewCache[index];
+      if (!view || view.byteOffset !== ptr || view.length !== size) {
+        view = viewCache[index] = new Int8Array(viewCacheBuffer, ptr, size);
+      }
+      return view;
+    }
 
+    // Argument wrappers are reused for every call in the synchronous
+    // build so dispatch does not create garbage. When calls can suspend,
+    // another connection may enter the VFS while a method is still
+    // using its arguments, so each call gets its own wrappers. A wrapper
+    // (and any view obtained from it) should not be retained after the
+    // VFS method returns or its Promise settles.
     class Value {
-      constructor(ptr, type) {
+      constructor(type, ptr) {
         this.ptr = ptr;
         this.type = type;
       }
 
       set(v) {
-        setValue(this.ptr, v, this.type);
+        if (this.type === 'i32') {
+          HEAP32[this.ptr >> 2] = v;
+        } else {
+          setInt64(this.ptr, v);
+        }
       }
     }
 
-    class Array {
+    class ArrayValue {
       constructor(ptr, size) {
         this.ptr = ptr;
         this.size = size;
       }
 
       get value() {
-        return new Int8Array(HEAP8.buffer, this.ptr, this.size);
+        return this.size !== undefined ?
+          getView(this.ptr, this.size) :
+          new Int8Array(HEAP8.buffer, this.ptr);
       }
     }
 
+    const argValue32 = new Value('i32', 0);
+    const argValue64 = new Value('i64', 0);
+    const argArray = new ArrayValue(0, 0);
+    const value32 = hasAsyncify ?
+      ptr => new Value('i32', ptr) :
+      ptr => (argValue32.ptr = ptr, argValue32);
+    const value64 = hasAsyncify ?
+      ptr => new Value('i64', ptr) :
+      ptr => (argValue64.ptr = ptr, argValue64);
+    const array = hasAsyncify ?
+      (ptr, size) => new ArrayValue(ptr, size) :
+      (ptr, size) => (argArray.ptr = ptr, argArray.size = size, argArray);
+
     // int xClose(sqlite3_file* file);
     _vfsClose = function(file) {
-      const vfs = mapFileToVFS.get(file);
-
-      if (hasAsyncify) {
-        // Normally we would delete the mapFileToVFS entry here as it is not
-        // needed once the file is closed. But if the close implementation
-        // uses Asyncify then the function can be called again with the same
-        // state expected. So instead we just remember keys that should be
-        // removed at some point.
-        closedFiles.add(file);
-      } else {
-        mapFileToVFS.delete(file);
-      }
+      const vfs = getVFS(file);
       return vfs['xClose'](file);
     }
     
     // int xRead(sqlite3_file* file, void* pData, int iAmt, sqlite3_int64 iOffset);
     _vfsRead = function(file, pData, iAmt, iOffset) {
-      const vfs = mapFileToVFS.get(file);
-      return vfs['xRead'](file, new Array(pData, iAmt), getValue(iOffset, 'i64'));
+      const vfs = getVFS(file);
+      return vfs['xRead'](file, array(pData, iAmt), getInt64(iOffset));
+    }
+
+    // int xReadAhead(sqlite3_file* file, sqlite3_int64 iOffset, int iAmt);
+    _vfsReadAhead = function(file, iOffset, iAmt) {
+      const vfs = getVFS(file);
+      return vfs['xReadAhead'](file, getInt64(iOffset), iAmt);
     }
 
     // int xWrite(sqlite3_file* file, const void* pData, int iAmt, sqlite3_int64 iOffset);
     _vfsWrite = function(file, pData, iAmt, iOffset) {
-      const vfs = mapFileToVFS.get(file);
-      return vfs['xWrite'](file, new Array(pData, iAmt), getValue(iOffset, 'i64'));
+      const vfs = getVFS(file);
+      return vfs['xWrite'](file, array(pData, iAmt), getInt64(iOffset));
+    }
+
+    // int xWriteBatch(sqlite3_file* file, int nWrites, const void* pWrites);
+    // Each write is a 16-byte header (64-bit offset, 32-bit length, 32-bit
+    // padding) followed by the data, padded to a multiple of 8 bytes.
+    _vfsWriteBatch = function(file, nWrites, pWrites) {
+      const vfs = getVFS(file);
+      const writes = [];
+      for (let i = 0, p = pWrites; i < nWrites; ++i) {
+        const iAmt = HEAP32[(p + 8) >> 2];
+        writes.push({
+          'offset': getInt64(p),
+          'data': HEAP8.subarray(p + 16, p + 16 + iAmt)
+        });
+        p += 16 + ((iAmt + 7) & ~7);
+      }
+      return vfs['xWriteBatch'](file, writes);
     }
 
     // int xTruncate(sqlite3_file* file, sqlite3_int64 size);
     _vfsTruncate = function(file, iSize) {
-      const vfs = mapFileToVFS.get(file);
-      return vfs['xTruncate'](file, getValue(iSize, 'i64'));
+      const vfs = getVFS(file);
+      return vfs['xTruncate'](file, getInt64(iSize));
     }
 
     // int xSync(sqlite3_file* file, int flags);
     _vfsSync = function(file, flags) {
-      const vfs = mapFileToVFS.get(file);
+      const vfs = getVFS(file);
       return vfs['xSync'](file, flags);
     }
 
     // int xFileSize(sqlite3_file* file, sqlite3_int64* pSize);
     _vfsFileSize = function(file, pSize) {
-      const vfs = mapFileToVFS.get(file);
-      return vfs['xFileSize'](file, new Value(pSize, 'i64'));
+      const vfs = getVFS(file);
+      return vfs['xFileSize'](file, value64(pSize));
     }
 
     // int xLock(sqlite3_file* file, int flags);
     _vfsLock = function(file, flags) {
-      const vfs = mapFileToVFS.get(file);
+      const vfs = getVFS(file);
       return vfs['xLock'](file, flags);
     }
 
     // int xUnlock(sqlite3_file* file, int flags);
     _vfsUnlock = function(file, flags) {
-      const vfs = mapFileToVFS.get(file);
+      const vfs = getVFS(file);
       return vfs['xUnlock'](file, flags);
     }
 
     // int xCheckReservedLock(sqlite3_file* file, int* pResOut);
     _vfsCheckReservedLock = function(file, pResOut) {
-      const vfs = mapFileToVFS.get(file);
-      return vfs['xCheckReservedLock'](file, new Value(pResOut, 'i32'));
+      const vfs = getVFS(file);
+      return vfs['xCheckReservedLock'](file, value32(pResOut));
     }
 
     // int xFileControl(sqlite3_file* file, int flags, void* pOut);
     _vfsFileControl = function(file, flags, pOut) {
-      const vfs = mapFileToVFS.get(file);
-      return vfs['xFileControl'](file, flags, new Array(pOut));
+      const vfs = getVFS(file);
+      return vfs['xFileControl'](file, flags, array(pOut, undefined));
     }
 
     // int xSectorSize(sqlite3_file* file);
     _vfsSectorSize = function(file) {
-      const vfs = mapFileToVFS.get(file);
+      const vfs = getVFS(file);
       return vfs['xSectorSize'](file);
     }
 
     // int xDeviceCharacteristics(sqlite3_file* file);
     _vfsDeviceCharacteristics = function(file) {
-      const vfs = mapFileToVFS.get(file);
+      const vfs = getVFS(file);
       return vfs['xDeviceCharacteristics'](file);
     }
+
+    // int xShmMap(sqlite3_file* file, int iPg, int pgsz, int bExtend, void volatile** pp);
+    _vfsShmMap = function(file, iPg, pgsz, bExtend, pData) {
+      const vfs = getVFS(file);
+      return vfs['xShmMap'](file, iPg, pgsz, bExtend, array(pData, pgsz));
+    }
+
+    // int xShmLock(sqlite3_file* file, int offset, int n, int flags);
+    _vfsShmLock = function(file, offset, n, flags) {
+      const vfs = getVFS(file);
+      return vfs['xShmLock'](file, offset, n, flags);
+    }
+
+    // void xShmBarrier(sqlite3_file* file);
+    _vfsShmBarrier = function(file) {
+      const vfs = getVFS(file);
+      vfs['xShmBarrier'](file);
+    }
+
+    // int xShmUnmap(sqlite3_file* file, int deleteFlag);
+    _vfsShmUnmap = function(file, deleteFlag) {
+      const vfs = getVFS(file);
+      return vfs['xShmUnmap'](file, deleteFlag);
+    }
+    
+    // int xFetch(sqlite3_file* file, sqlite3_int64 iOfst, int iAmt, void** pp);
+    _vfsFetch = function(file, iOffset, iAmt, pp) {
+      const vfs = getVFS(file);
+      return vfs['xFetch'](file, getInt64(iOffset), iAmt, value32(pp));
+    }
+
+    // int xUnfetch(sqlite3_file* file, sqlite3_int64 iOfst, void* p);
+    _vfsUnfetch = function(file, iOffset, p) {
+      const vfs = getVFS(file);
+      return vfs['xUnfetch'](file, getInt64(iOffset), p);
+    }
     
     // int xOpen(sqlite3_vfs* vfs, const char *zName, sqlite3_file* file, int flags, int *pOutFlags);
     _vfsOpen = function(vfsId, zName, file, flags, pOutFlags) {
       const vfs = mapIdToVFS.get(vfsId);
-      mapFileToVFS.set(file, vfs);
-
-      if (hasAsyncify) {
-        closedFiles.delete(file);
-        for (const file of closedFiles) {
-          mapFileToVFS.delete(file);
-        }
-      }
-      
-      // If zName is a URI, then the null-terminated name is followed by
-      // additional key and value strings. Reassemble it into a single
-      // string.
-      let name = null;
-      if (flags & 64) {
-        let pName = zName;
-        let state = 1;
-        const charCodes = [];
-        while (state) {
-          const charCode = HEAP8[pName++];
-          if (charCode) {
-            charCodes.push(charCode);
-          } else {
-            if (!HEAP8[pName]) state = null;
-            switch (state) {
-              case 1: // path
-                charCodes.push('?'.charCodeAt(0));
-                state = 2;
-                break;
-              case 2: // key
-                charCodes.push('='.charCodeAt(0));
-                state = 3;
-                break;
-              case 3: // value
-                charCodes.push('&'.charCodeAt(0));
-                state = 2;
-                break;
-            }
-          }
-        }
-        name = new TextDecoder().decode(new Int8Array(charCodes));
-      } else if (zName) {
-        name = UTF8ToString(zName);
-      }
 
-      return vfs['xOpen'](name, file, flags, new Value(pOutFlags, 'i32'));
+      // URI filenames are reassembled into a single string in libvfs.c.
+      const name = zName ? UTF8ToString(zName) : null;
+      return vfs['xOpen'](name, file, flags, value32(pOutFlags));
     }
 
     // int xDelete(sqlite3_vfs* vfs, const char *zName, int syncDir);
@@ -197,7 +305,7 @@ const vfs_methods = {
     // int xAccess(sqlite3_vfs* vfs, const char *zName, int flags, int *pResOut);
     _vfsAccess = function(vfsId, zName, flags, pResOut) {
       const vfs = mapIdToVFS.get(vfsId);
-      return vfs['xAccess'](UTF8ToString(zName), flags, new Value(pResOut, 'i32'));
+      return vfs['xAccess'](UTF8ToString(zName), flags, value32(pResOut));
     }
   }
 };
@@ -205,7 +313,9 @@ const vfs_methods = {
 const VFS_METHOD_NAMES = [
   "vfsClose",
   "vfsRead",
+  "vfsReadAhead",
   "vfsWrite",
+  "vfsWriteBatch",
   "vfsTruncate",
   "vfsSync",
   "vfsFileSize",
@@ -215,6 +325,12 @@ const VFS_METHOD_NAMES = [
   "vfsFileControl",
   "vfsSectorSize",
   "vfsDeviceCharacteristics",
+  "vfsShmMap",
+  "vfsShmLock",
+  "vfsShmBarrier",
+  "vfsShmUnmap",
+  "vfsFetch",
+  "vfsUnfetch",
   
   "vfsOpen",
   "vfsDelete",
@@ -28,6 +28,20 @@ export function Factory(Module) {
   const tmp = Module._malloc(8);
   const tmpPtr = [tmp, tmp + 4];
 
+  // API functions that take and return only numbers and never suspend
+  // call the exported WebAssembly function directly. Module.cwrap is
+  // used only where strings are marshalled or the call may be async.
+
+  // The *_sync variants of API functions that may suspend call the
+  // export directly, which is only valid when the module is built
+  // without Asyncify or JSPI (see libvfs.js). Otherwise they throw.
+  function syncExport(fname) {
+    if (Module.isAsync === false) return Module[`_${fname}`];
+    return function() {
+      throw new SQLiteError(`${fname} requires a synchronous build`, SQLite.SQLITE_MISUSE);
+    };
+  }
+
   // Convert a JS string to a C string. sqlite3_malloc is used to allocate
   // memory (use sqlite3_free to deallocate).
   function createUTF8(s) {
@@ -38,7 +52,40 @@ export function Factory(Module) {
     return zts;
   }
 
+  // Decode UTF-8 from the WebAssembly heap given its length, which
+  // avoids scanning for a terminator. Short ASCII strings are built
+  // directly because that is faster than a TextDecoder call. Callers
+  // get the address before the length, as SQLite documents, because
+  // fetching the text can change the length.
+  const ASCII_FAST_PATH_LIMIT = 32;
+  const textDecoder = new TextDecoder();
+  function decodeUTF8(address, nBytes) {
+    const heap = Module.HEAPU8;
+    if (nBytes <= ASCII_FAST_PATH_LIMIT) {
+      let s = '';
+      for (let i = address; i < address + nBytes; ++i) {
+        const c = heap[i];
+        if (c & 0x80) {
+          return textDecoder.decode(heap.subarray(address, address + nBytes));
+        }
+        s += String.fromCharCode(c);
+      }
+      return s;
+    }
+    return textDecoder.decode(heap.subarray(address, address + nBytes));
+  }
+
+  // 64-bit integer exports take BigInt. Numbers are truncated to an
+  // integer first.
+  function toBigInt(value) {
+    return typeof value === 'bigint' ? value : BigInt(Math.trunc(value));
+  }
+
   const databases = new Set();
+
+  // Databases for which INTEGER columns are returned as BigInt. Other
+  // INTEGER values are returned as Number, which is exact up to 2^53.
+  const bigintDatabases = new Set();
   function verifyDatabase(db) {
     if (!databases.has(db)) {
       throw new SQLiteError('not a database', SQLite.SQLITE_MISUSE);
@@ -46,12 +93,103 @@ export function Factory(Module) {
   }
 
   const mapStmtToDB = new Map();
+
+  // Statements for which step_rows() has reached SQLITE_DONE.
+  const stmtsDone = new Set();
+
+  // Row buffers for step_rows(), by statement. Each is a heap block
+  // holding the address and size of the buffer, which C grows as
+  // needed, and the number of rows packed. A buffer belongs to one
+  // statement so a call on another statement, e.g. from another
+  // connection while an async step is suspended, cannot replace it.
+  const mapStmtToRowBuffer = new Map();
+
+  // Statement caches for prepare_cached(), by database. Each cache Map
+  // is keyed by SQL text and kept in least recently used order. An entry
+  // usually has one statement, with more added when the SQL is prepared
+  // again while its statements are still being stepped. Evicted
+  // statements that are still being stepped are finalized later (see
+  // evictStatements).
+  const DEFAULT_STATEMENT_CACHE_SIZE = 64;
+  /** @type {Map<number, { capacity: number, entries: Map<string, { stmts: number[], tail: string }|null>, evicted: Set<number> }>} */
+  const mapDBToStatementCache = new Map();
+  const mapCachedStmtToSQL = new Map();
   function verifyStatement(stmt) {
     if (!mapStmtToDB.has(stmt)) {
       throw new SQLiteError('not a statement', SQLite.SQLITE_MISUSE);
     }
   }
 
+  // Heap buffers for text and blob bindings, by statement and parameter
+  // index. Values are bound with SQLITE_STATIC, so the buffer bound to a
+  // parameter must not change until the parameter is bound again or the
+  // statement is finalized. Each parameter has a bound buffer and a
+  // spare: a value is written to the spare, which replaces the bound
+  // buffer only if the bind succeeds, so a failed bind (e.g. on a
+  // statement that has not been reset) leaves the existing binding
+  // intact. Buffers are reused for later bindings of the parameter and
+  // only reallocated when a larger value is bound.
+  /** @typedef {{ ptr: number, size: number }} BindBuffer */
+  /** @type {Map<number, Map<number, { bound: BindBuffer?, spare: BindBuffer? }>>} */
+  const mapStmtToBindBuffers = new Map();
+  const SQLITE_STATIC = 0;
+  const textEncoder = new TextEncoder();
+  function getBindBuffer(stmt, i, nBytes) {
+    let buffers = mapStmtToBindBuffers.get(stmt);
+    if (!buffers) {
+      buffers = new Map();
+      mapStmtToBindBuffers.set(stmt, buffers);
+    }
+
+    let pair = buffers.get(i);
+    if (!pair) {
+      pair = { bound: null, spare: null };
+      buffers.set(i, pair);
+    }
+
+    let spare = pair.spare;
+    if (!spare || spare.size < nBytes) {
+      const size = Math.max(nBytes, (spare?.size ?? 0) * 2, 64);
+      const ptr = Module._sqlite3_malloc(size);
+      if (!ptr) throw new SQLiteError('out of memory', SQLite.SQLITE_NOMEM);
+
+      // The spare buffer is never bound, so it can be freed.
+      if (spare) Module._sqlite3_free(spare.ptr);
+      spare = pair.spare = { ptr, size };
+    }
+    return spare.ptr;
+  }
+
+  // Make the spare buffer from getBindBuffer() the bound buffer after
+  // a successful bind.
+  function swapBindBuffer(stmt, i) {
+    const pair = mapStmtToBindBuffers.get(stmt).get(i);
+    [pair.bound, pair.spare] = [pair.spare, pair.bound];
+  }
+
+  sqlite3.aggregate_context = (function() {
+    const fname = 'sqlite3_aggregate_context';
+    const f = Module[`_${fname}`];
+    return function(context, nBytes) {
+      const result = f(context, nBytes);
+      // trace(fname, result);
+      return result;
+    };
+  })();
+
+  sqlite3.aggregate_context_f64 = function(context, nValues) {
+    // SQLite zero-fills the context on allocation and aligns it to 8
+    // bytes, so it can be viewed as doubles.
+    const ptr = sqlite3.aggregate_context(context, nValues * 8);
+    if (!ptr) {
+      // Nothing is allocated when no size is requested, e.g. from the
+      // final callback for an empty group.
+      if (nValues === 0) return null;
+      throw new SQLiteError('out of memory', SQLite.SQLITE_NOMEM);
+    }
+    return Module.HEAPF64.subarray(ptr >> 3, (ptr >> 3) + nValues);
+  };
+
   sqlite3.bind_collection = function(stmt, bindings) {
     verifyStatement(stmt);
     const isArray = Array.isArray(bindings);
@@ -72,9 +210,13 @@ export function Factory(Module) {
       case 'number':
         if (value === (value | 0)) {
           return sqlite3.bind_int(stmt, i, value);
+        } else if (Number.isSafeInteger(value)) {
+          return sqlite3.bind_int64(stmt, i, BigInt(value));
         } else {
           return sqlite3.bind_double(stmt, i, value);
         }
+      case 'bigint':
+        return sqlite3.bind_int64(stmt, i, value);
       case 'string':
         return sqlite3.bind_text(stmt, i, value);
       default:
@@ -94,14 +236,15 @@ export function Factory(Module) {
 
   sqlite3.bind_blob = (function() {
     const fname = 'sqlite3_bind_blob';
-    const f = Module.cwrap(fname, ...decl('nnnnn:n'));
+    const f = Module[`_${fname}`];
     return function(stmt, i, value) {
       verifyStatement(stmt);
       // @ts-ignore
       const byteLength = value.byteLength ?? value.length;
-      const ptr = Module._sqlite3_malloc(byteLength);
-      Module.HEAP8.subarray(ptr).set(value);
-      const result = f(stmt, i, ptr, byteLength, sqliteFreeAddress);
+      const ptr = getBindBuffer(stmt, i, byteLength);
+      Module.HEAP8.set(value, ptr);
+      const result = f(stmt, i, ptr, byteLength, SQLITE_STATIC);
+      if (result === SQLite.SQLITE_OK) swapBindBuffer(stmt, i);
       // trace(fname, result);
       return check(fname, result, mapStmtToDB.get(stmt));
     };
@@ -109,7 +252,7 @@ export function Factory(Module) {
 
   sqlite3.bind_parameter_count = (function() {
     const fname = 'sqlite3_bind_parameter_count';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
     return function(stmt) {
       verifyStatement(stmt);
       const result = f(stmt);
@@ -120,7 +263,7 @@ export function Factory(Module) {
 
   sqlite3.bind_double = (function() {
     const fname = 'sqlite3_bind_double';
-    const f = Module.cwrap(fname, ...decl('nnn:n'));
+    const f = Module[`_${fname}`];
     return function(stmt, i, value) {
       verifyStatement(stmt);
       const result = f(stmt, i, value);
@@ -131,7 +274,7 @@ export function Factory(Module) {
 
   sqlite3.bind_int = (function() {
     const fname = 'sqlite3_bind_int';
-    const f = Module.cwrap(fname, ...decl('nnn:n'));
+    const f = Module[`_${fname}`];
     return function(stmt, i, value) {
       verifyStatement(stmt);
       const result = f(stmt, i, value);
@@ -140,9 +283,20 @@ export function Factory(Module) {
     };
   })();
 
+  sqlite3.bind_int64 = (function() {
+    const fname = 'sqlite3_bind_int64';
+    const f = Module[`_${fname}`];
+    return function(stmt, i, value) {
+      verifyStatement(stmt);
+      const result = f(stmt, i, toBigInt(value));
+      // trace(fname, result);
+      return check(fname, result, mapStmtToDB.get(stmt));
+    };
+  })();
+
   sqlite3.bind_null = (function() {
     const fname = 'sqlite3_bind_null';
-    const f = Module.cwrap(fname, ...decl('nn:n'));
+    const f = Module[`_${fname}`];
     return function(stmt, i) {
       verifyStatement(stmt);
       const result = f(stmt, i);
@@ -164,11 +318,20 @@ export function Factory(Module) {
 
   sqlite3.bind_text = (function() {
     const fname = 'sqlite3_bind_text';
-    const f = Module.cwrap(fname, ...decl('nnnnn:n'));
+    const f = Module[`_${fname}`];
     return function(stmt, i, value) {
       verifyStatement(stmt);
-      const ptr = createUTF8(value);
-      const result = f(stmt, i, ptr, -1, sqliteFreeAddress);
+      if (typeof value !== 'string') return sqlite3.bind_null(stmt, i);
+
+      // Encode directly into the bind buffer, which is sized for the
+      // worst case of 3 UTF-8 bytes per UTF-16 code unit.
+      const maxBytes = value.length * 3;
+      const ptr = getBindBuffer(stmt, i, maxBytes);
+      const { written } = textEncoder.encodeInto(
+        value,
+        Module.HEAPU8.subarray(ptr, ptr + maxBytes));
+      const result = f(stmt, i, ptr, written, SQLITE_STATIC);
+      if (result === SQLite.SQLITE_OK) swapBindBuffer(stmt, i);
       // trace(fname, result);
       return check(fname, result, mapStmtToDB.get(stmt));
     };
@@ -176,7 +339,7 @@ export function Factory(Module) {
 
   sqlite3.changes = (function() {
     const fname = 'sqlite3_changes';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
     return function(db) {
       verifyDatabase(db);
       const result = f(db);
@@ -190,22 +353,69 @@ export function Factory(Module) {
     const f = Module.cwrap(fname, ...decl('n:n'), { async });
     return async function(db) {
       verifyDatabase(db);
+
+      // Finalize cached statements, which would otherwise keep the
+      // database from closing.
+      const cache = mapDBToStatementCache.get(db);
+      if (cache) {
+        for (const entry of cache.entries.values()) {
+          for (const stmt of entry?.stmts.slice() ?? []) {
+            await sqlite3.finalize(stmt);
+          }
+        }
+        for (const stmt of cache.evicted) {
+          await sqlite3.finalize(stmt);
+        }
+        mapDBToStatementCache.delete(db);
+      }
+
       const result = await f(db);
       databases.delete(db);
+      bigintDatabases.delete(db);
+      return check(fname, result, db);
+    };
+  })();
+
+  sqlite3.close_sync = (function() {
+    const fname = 'sqlite3_close';
+    const f = syncExport(fname);
+    return function(db) {
+      verifyDatabase(db);
+      const cache = mapDBToStatementCache.get(db);
+      if (cache) {
+        for (const entry of cache.entries.values()) {
+          for (const stmt of entry?.stmts.slice() ?? []) {
+            sqlite3.finalize_sync(stmt);
+          }
+        }
+        for (const stmt of cache.evicted) {
+          sqlite3.finalize_sync(stmt);
+        }
+        mapDBToStatementCache.delete(db);
+      }
+
+      const result = f(db);
+      databases.delete(db);
+      bigintDatabases.delete(db);
       return check(fname, result, db);
     };
   })();
 
   sqlite3.column = function(stmt, iCol) {
     verifyStatement(stmt);
-    const type = sqlite3.column_type(stmt, iCol);
+
+    // The statement is verified once here, so the numeric accessors
+    // are called directly.
+    const type = Module._sqlite3_column_type(stmt, iCol);
     switch (type) {
       case SQLite.SQLITE_BLOB:
         return sqlite3.column_blob(stmt, iCol);
       case SQLite.SQLITE_FLOAT:
-        return sqlite3.column_double(stmt, iCol);
+        return Module._sqlite3_column_double(stmt, iCol);
       case SQLite.SQLITE_INTEGER:
-        return sqlite3.column_int(stmt, iCol);
+        return bigintDatabases.has(mapStmtToDB.get(stmt)) ?
+          Module._sqlite3_column_int64(stmt, iCol) :
+          Module._sqlite3_column_double(stmt, iCol);
       case SQLite.SQLITE_NULL:
         return null;
       case SQLite.SQLITE_TEXT:
@@ -217,7 +427,7 @@ export function Factory(Module) {
 
   sqlite3.column_blob = (function() {
     const fname = 'sqlite3_column_blob';
-    const f = Module.cwrap(fname, ...decl('nn:n'));
+    const f = Module[`_${fname}`];
     return function(stmt, iCol) {
       verifyStatement(stmt);
       const nBytes = sqlite3.column_bytes(stmt, iCol);
@@ -230,7 +440,7 @@ export function Factory(Module) {
 
   sqlite3.column_bytes = (function() {
     const fname = 'sqlite3_column_bytes';
-    const f = Module.cwrap(fname, ...decl('nn:n'));
+    const f = Module[`_${fname}`];
     return function(stmt, iCol) {
       verifyStatement(stmt);
       const result = f(stmt, iCol);
@@ -241,7 +451,7 @@ export function Factory(Module) {
 
   sqlite3.column_count = (function() {
     const fname = 'sqlite3_column_count';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
     return function(stmt) {
       verifyStatement(stmt);
       const result = f(stmt);
@@ -252,7 +462,7 @@ export function Factory(Module) {
 
   sqlite3.column_double = (function() {
     const fname = 'sqlite3_column_double';
-    const f = Module.cwrap(fname, ...decl('nn:n'));
+    const f = Module[`_${fname}`];
     return function(stmt, iCol) {
       verifyStatement(stmt);
       const result = f(stmt, iCol);
@@ -263,7 +473,18 @@ export function Factory(Module) {
 
   sqlite3.column_int = (function() {
     const fname = 'sqlite3_column_int';
-    const f = Module.cwrap(fname, ...decl('nn:n'));
+    const f = Module[`_${fname}`];
+    return function(stmt, iCol) {
+      verifyStatement(stmt);
+      const result = f(stmt, iCol);
+      // trace(fname, result);
+      return result;
+    };
+  })();
+
+  sqlite3.column_int64 = (function() {
+    const fname = 'sqlite3_column_int64';
+    const f = Module[`_${fname}`];
     return function(stmt, iCol) {
       verifyStatement(stmt);
       const result = f(stmt, iCol);
@@ -294,10 +515,12 @@ export function Factory(Module) {
 
   sqlite3.column_text = (function() {
     const fname = 'sqlite3_column_text';
-    const f = Module.cwrap(fname, ...decl('nn:s'));
+    const f = Module[`_${fname}`];
     return function(stmt, iCol) {
       verifyStatement(stmt);
-      const result = f(stmt, iCol);
+      const address = f(stmt, iCol);
+      const nBytes = Module._sqlite3_column_bytes(stmt, iCol);
+      const result = decodeUTF8(address, nBytes);
       // trace(fname, result);
       return result;
     };
@@ -305,7 +528,7 @@ export function Factory(Module) {
 
   sqlite3.column_type = (function() {
     const fname = 'sqlite3_column_type';
-    const f = Module.cwrap(fname, ...decl('nn:n'));
+    const f = Module[`_${fname}`];
     return function(stmt, iCol) {
       verifyStatement(stmt);
       const result = f(stmt, iCol);
@@ -314,6 +537,16 @@ export function Factory(Module) {
     };
   })();
 
+  sqlite3.create_column_aggregate = function(db, zFunctionName, nArg, eTextRep, pApp, xFinal) {
+    verifyDatabase(db);
+    // Each argument is a column, so the count must be fixed.
+    if (!(nArg >= 1)) {
+      throw new SQLiteError('invalid argument count', SQLite.SQLITE_MISUSE);
+    }
+    const result = Module.createColumnAggregate(db, zFunctionName, nArg, eTextRep, pApp, xFinal);
+    return check('sqlite3_create_function', result, db);
+  };
+
   sqlite3.create_function = function(db, zFunctionName, nArg, eTextRep, pApp, xFunc, xStep, xFinal) {
     verifyDatabase(db);
     if (xFunc && !xStep && !xFinal) {
@@ -329,15 +562,31 @@ export function Factory(Module) {
     throw new SQLiteError('invalid function combination', SQLite.SQLITE_MISUSE);
   };
 
+  sqlite3.create_function_decoded = function(db, zFunctionName, nArg, eTextRep, pApp, xFunc) {
+    verifyDatabase(db);
+    const result = Module.createFunctionDecoded(db, zFunctionName, nArg, eTextRep, pApp, xFunc);
+    return check('sqlite3_create_function', result, db);
+  };
+
   sqlite3.create_module = function(db, zName, module, appData) {
     verifyDatabase(db);
     const result = Module.createModule(db, zName, module, appData);
     return check('sqlite3_create_module', result, db);
   };
 
+  sqlite3.create_window_function = function(db, zFunctionName, nArg, eTextRep, pApp, xStep, xFinal, xValue, xInverse) {
+    verifyDatabase(db);
+    if (!xStep || !xFinal || !xValue || !xInverse) {
+      throw new SQLiteError('invalid function combination', SQLite.SQLITE_MISUSE);
+    }
+
+    const result = Module.createWindowFunction(db, zFunctionName, nArg, eTextRep, pApp, xStep, xFinal, xValue, xInverse);
+    return check('sqlite3_create_window_function', result, db);
+  };
+
   sqlite3.data_count = (function() {
     const fname = 'sqlite3_data_count';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
     return function(stmt) {
       verifyStatement(stmt);
       const result = f(stmt);
@@ -365,13 +614,195 @@ export function Factory(Module) {
     return async function(stmt) {
       verifyStatement(stmt);
       const result = await f(stmt);
+      const db = forgetStatement(stmt);
+      return check(fname, result, db);
+    };
+  })();
 
-      const db = mapStmtToDB.get(stmt);
-      mapStmtToDB.delete(stmt)
+  sqlite3.finalize_sync = (function() {
+    const fname = 'sqlite3_finalize';
+    const f = syncExport(fname);
+    return function(stmt) {
+      verifyStatement(stmt);
+      const result = f(stmt);
+      const db = forgetStatement(stmt);
       return check(fname, result, db);
     };
   })();
 
+  // Release API resources for a finalized statement and return its
+  // database.
+  function forgetStatement(stmt) {
+    const db = mapStmtToDB.get(stmt);
+    mapStmtToDB.delete(stmt)
+    stmtsDone.delete(stmt);
+    for (const { bound, spare } of mapStmtToBindBuffers.get(stmt)?.values() ?? []) {
+      if (bound) Module._sqlite3_free(bound.ptr);
+      if (spare) Module._sqlite3_free(spare.ptr);
+    }
+    mapStmtToBindBuffers.delete(stmt);
+    const pRowBuffer = mapStmtToRowBuffer.get(stmt);
+    if (pRowBuffer) {
+      Module._sqlite3_free(Module.getValue(pRowBuffer, 'i32'));
+      Module._free(pRowBuffer);
+      mapStmtToRowBuffer.delete(stmt);
+    }
+    if (mapCachedStmtToSQL.has(stmt)) {
+      const sql = mapCachedStmtToSQL.get(stmt);
+      const entries = mapDBToStatementCache.get(db)?.entries;
+      const entry = entries?.get(sql);
+      if (entry) {
+        entry.stmts.splice(entry.stmts.indexOf(stmt), 1);
+        if (!entry.stmts.length) entries.delete(sql);
+      }
+      mapCachedStmtToSQL.delete(stmt);
+    }
+    mapDBToStatementCache.get(db)?.evicted.delete(stmt);
+    return db;
+  }
+
+  sqlite3.get_auxdata = function(context, iArg) {
+    return Module.getAuxData(context, iArg);
+  };
+
+  sqlite3.insert_many = (function() {
+    const fname = 'insert_many';
+    const f = Module.cwrap(fname, ...decl('nnnnn:n'), { async });
+
+    // Rows are packed (see librows.c) into a buffer that is grown as
+    // needed. Large inputs are passed to C in batches of about
+    // INSERT_BATCH_SIZE bytes. Each call has its own buffer because
+    // values are bound with SQLITE_STATIC, so the buffer must not be
+    // changed by another call, e.g. from another connection while an
+    // async step is suspended, until the bindings are cleared.
+    const INSERT_BATCH_SIZE = 1 << 20;
+    function reserve(buffer, nBytes) {
+      if (nBytes <= buffer.size) return;
+      const size = Math.max(nBytes, buffer.size * 2, 4096);
+      const ptr = Module._sqlite3_malloc(size);
+      if (!ptr) throw new SQLiteError('out of memory', SQLite.SQLITE_NOMEM);
+      Module.HEAPU8.copyWithin(ptr, buffer.ptr, buffer.ptr + buffer.size);
+      Module._sqlite3_free(buffer.ptr);
+      buffer.ptr = ptr;
+      buffer.size = size;
+    }
+
+    // Pack one row at offset and return the offset after it.
+    function pack(buffer, values, offset) {
+      // Reserve space for the largest possible encoding.
+      let maxBytes = 0;
+      for (const value of values) {
+        if (typeof value === 'string') {
+          maxBytes += 8 + value.length * 3 + 7;
+        } else if (value instanceof Int8Array || Array.isArray(value)) {
+          // @ts-ignore
+          maxBytes += 8 + (value.byteLength ?? value.length) + 7;
+        } else {
+          maxBytes += 16;
+        }
+      }
+      reserve(buffer, offset + maxBytes);
+
+      const heap = Module.HEAPU8;
+      const view = new DataView(heap.buffer);
+      for (const value of values) {
+        let type = SQLite.SQLITE_NULL;
+        let nBytes = 0;
+        const payload = buffer.ptr + offset + 8;
+        switch (typeof value) {
+          case 'number':
+            if (value === (value | 0)) {
+              type = SQLite.SQLITE_INTEGER;
+              view.setInt32(payload, value, true);
+              view.setInt32(payload + 4, value >> 31, true);
+            } else if (Number.isSafeInteger(value)) {
+              type = SQLite.SQLITE_INTEGER;
+              view.setBigInt64(payload, BigInt(value), true);
+            } else {
+              type = SQLite.SQLITE_FLOAT;
+              view.setFloat64(payload, value, true);
+            }
+            nBytes = 8;
+            break;
+          case 'bigint':
+            type = SQLite.SQLITE_INTEGER;
+            view.setBigInt64(payload, value, true);
+            nBytes = 8;
+            break;
+          case 'string':
+            type = SQLite.SQLITE_TEXT;
+            nBytes = textEncoder.encodeInto(
+              value,
+              heap.subarray(payload, payload + value.length * 3)).written;
+            break;
+          default:
+            if (value instanceof Int8Array || Array.isArray(value)) {
+              type = SQLite.SQLITE_BLOB;
+              // @ts-ignore
+              nBytes = value.byteLength ?? value.length;
+              Module.HEAP8.set(value, payload);
+            } else if (value !== null && value !== undefined) {
+              console.warn('unknown binding converted to null', value);
+            }
+            break;
+        }
+        view.setInt32(buffer.ptr + offset, type, true);
+        view.setInt32(buffer.ptr + offset + 4, nBytes, true);
+        offset += 8 + ((nBytes + 7) & ~7);
+      }
+      return offset;
+    }
+
+    return async function(stmt, rows) {
+      verifyStatement(stmt);
+      stmtsDone.delete(stmt);
+      const nColumns = sqlite3.bind_parameter_count(stmt);
+      let names = null;
+      const buffer = { ptr: 0, size: 0 };
+      const pnDone = Module._malloc(4);
+      try {
+        let iRow = 0;
+        while (iRow < rows.length) {
+          // Pack a batch of rows.
+          const iFirst = iRow;
+          let offset = 0;
+          do {
+            const row = rows[iRow++];
+            const values = new Array(nColumns);
+            if (Array.isArray(row)) {
+              for (let i = 0; i < nColumns; ++i) {
+                values[i] = row[i];
+              }
+            } else {
+              names = names ?? Array.from(
+                { length: nColumns },
+                (_, i) => sqlite3.bind_parameter_name(stmt, i + 1));
+              for (let i = 0; i < nColumns; ++i) {
+                values[i] = row[names[i]];
+              }
+            }
+            offset = pack(buffer, values, offset);
+          } while (iRow < rows.length && offset < INSERT_BATCH_SIZE);
+
+          const result = await f(stmt, iRow - iFirst, nColumns, buffer.ptr, pnDone);
+          try {
+            check(fname, result, mapStmtToDB.get(stmt));
+          } catch (e) {
+            // Report how many rows were executed before the error.
+            e.rowsDone = iFirst + Module.getValue(pnDone, 'i32');
+            throw e;
+          }
+        }
+      } finally {
+        // Bindings refer to the buffer, which is freed.
+        Module._sqlite3_clear_bindings(stmt);
+        Module._sqlite3_free(buffer.ptr);
+        Module._free(pnDone);
+      }
+      return SQLite.SQLITE_OK;
+    };
+  })();
+
   sqlite3.libversion = (function() {
     const fname = 'sqlite3_libversion';
     const f = Module.cwrap(fname, ...decl(':s'));
@@ -383,7 +814,7 @@ export function Factory(Module) {
 
   sqlite3.libversion_number = (function() {
     const fname = 'sqlite3_libversion_number';
-    const f = Module.cwrap(fname, ...decl(':n'));
+    const f = Module[`_${fname}`];
     return function() {
       const result = f();
       return result;
@@ -408,6 +839,30 @@ export function Factory(Module) {
     };
   })();
 
+  sqlite3.open_v2_sync = (function() {
+    const fname = 'sqlite3_open_v2';
+    const f = syncExport(fname);
+    return function(zFilename, flags, zVfs) {
+      flags = flags || SQLite.SQLITE_OPEN_CREATE | SQLite.SQLITE_OPEN_READWRITE;
+      zFilename = createUTF8(zFilename);
+      zVfs = createUTF8(zVfs);
+      let result;
+      try {
+        result = f(zFilename, tmpPtr[0], flags, zVfs);
+      } finally {
+        Module._sqlite3_free(zFilename);
+        Module._sqlite3_free(zVfs);
+      }
+
+      const db = Module.getValue(tmpPtr[0], 'i32');
+      databases.add(db);
+
+      Module._RegisterExtensionFunctions(db);
+      check(fname, result);
+      return db;
+    };
+  })();
+
   sqlite3.prepare_v2 = (function() {
     const fname = 'sqlite3_prepare_v2';
     const f = Module.cwrap(fname, ...decl('nnnnn:n'), { async });
@@ -424,31 +879,186 @@ export function Factory(Module) {
     };
   })();
 
+  sqlite3.prepare_v2_sync = (function() {
+    const fname = 'sqlite3_prepare_v2';
+    const f = syncExport(fname);
+    return function(db, sql) {
+      const result = f(db, sql, -1, tmpPtr[0], tmpPtr[1]);
+      check(fname, result, db);
+
+      const stmt = Module.getValue(tmpPtr[0], 'i32');
+      if (stmt) {
+        mapStmtToDB.set(stmt, db);
+        return { stmt, sql: Module.getValue(tmpPtr[1], 'i32') };
+      }
+      return null;
+    };
+  })();
+
+  // Cached statements can still be in use when they are evicted, e.g.
+  // by prepare_cached() calls in a loop over the rows of an evicted
+  // statement. Statements that are being stepped are not finalized
+  // immediately but set aside until they are no longer busy, and then
+  // finalized by the next call that uses the cache or by close().
+  const stmt_busy = Module._sqlite3_stmt_busy;
+  async function evictStatements(cache, stmts) {
+    for (const stmt of stmts.slice()) {
+      if (stmt_busy(stmt)) {
+        mapCachedStmtToSQL.delete(stmt);
+        cache.evicted.add(stmt);
+      } else {
+        await sqlite3.finalize(stmt);
+      }
+    }
+  }
+
+  async function finalizeEvicted(cache) {
+    for (const stmt of cache.evicted) {
+      if (!stmt_busy(stmt)) {
+        await sqlite3.finalize(stmt);
+      }
+    }
+  }
+
+  function getStatementCache(db) {
+    let cache = mapDBToStatementCache.get(db);
+    if (!cache) {
+      cache = {
+        capacity: DEFAULT_STATEMENT_CACHE_SIZE,
+        entries: new Map(),
+        evicted: new Set()
+      };
+      mapDBToStatementCache.set(db, cache);
+    }
+    return cache;
+  }
+
+  sqlite3.prepare_cached = (function() {
+    // Reset without checking the result, which reports any error from
+    // the previous use of the statement.
+    const reset = Module.cwrap('sqlite3_reset', ...decl('n:n'), { async });
+
+    async function prepare(db, sql) {
+      const str = sqlite3.str_new(db, sql);
+      try {
+        const prepared = await sqlite3.prepare_v2(db, sqlite3.str_value(str));
+        return prepared && {
+          stmt: prepared.stmt,
+          tail: Module.UTF8ToString(prepared.sql).trim()
+        };
+      } finally {
+        sqlite3.str_finish(str);
+      }
+    }
+
+    return async function(db, sql) {
+      verifyDatabase(db);
+      const cache = getStatementCache(db);
+      await finalizeEvicted(cache);
+
+      let entry = cache.entries.get(sql);
+      if (entry !== undefined) {
+        // Move to most recently used.
+        cache.entries.delete(sql);
+        cache.entries.set(sql, entry);
+        if (!entry) return null;
+
+        // A statement that is still being stepped (e.g. by an outer use
+        // of the same SQL) must not be reset, so use another one.
+        const stmt = entry.stmts.find(stmt => !stmt_busy(stmt));
+        if (stmt) {
+          stmtsDone.delete(stmt);
+          await reset(stmt);
+          return { stmt, tail: entry.tail };
+        }
+
+        const prepared = await prepare(db, sql);
+        entry.stmts.push(prepared.stmt);
+        mapCachedStmtToSQL.set(prepared.stmt, sql);
+        return prepared;
+      }
+
+      const prepared = await prepare(db, sql);
+
+      // SQL with no statement (e.g. only a comment) is cached as null.
+      while (cache.entries.size >= cache.capacity) {
+        const [oldSQL, oldEntry] = cache.entries.entries().next().value;
+        cache.entries.delete(oldSQL);
+        await evictStatements(cache, oldEntry?.stmts ?? []);
+      }
+      entry = prepared && { stmts: [prepared.stmt], tail: prepared.tail };
+      cache.entries.set(sql, entry);
+      if (entry) mapCachedStmtToSQL.set(prepared.stmt, sql);
+      return prepared;
+    };
+  })();
+
+  sqlite3.prepare_cache_size = async function(db, capacity) {
+    verifyDatabase(db);
+    if (!(capacity >= 1)) {
+      throw new SQLiteError('invalid cache size', SQLite.SQLITE_MISUSE);
+    }
+
+    const cache = getStatementCache(db);
+    cache.capacity = capacity;
+    await finalizeEvicted(cache);
+    while (cache.entries.size > capacity) {
+      const [oldSQL, oldEntry] = cache.entries.entries().next().value;
+      cache.entries.delete(oldSQL);
+      await evictStatements(cache, oldEntry?.stmts ?? []);
+    }
+  };
+
   sqlite3.reset = (function() {
     const fname = 'sqlite3_reset';
     const f = Module.cwrap(fname, ...decl('n:n'), { async });
     return async function(stmt) {
       verifyStatement(stmt);
+      stmtsDone.delete(stmt);
       const result = await f(stmt);
       return check(fname, result, mapStmtToDB.get(stmt));
     };
   })();
 
+  sqlite3.reset_sync = (function() {
+    const fname = 'sqlite3_reset';
+    const f = syncExport(fname);
+    return function(stmt) {
+      verifyStatement(stmt);
+      stmtsDone.delete(stmt);
+      const result = f(stmt);
+      return check(fname, result, mapStmtToDB.get(stmt));
+    };
+  })();
+
   sqlite3.result = function(context, value) {
     switch (typeof value) {
       case 'number':
         if (value === (value | 0)) {
           sqlite3.result_int(context, value);
+        } else if (Number.isSafeInteger(value)) {
+          sqlite3.result_int64(context, BigInt(value));
         } else {
           sqlite3.result_double(context, value);
         }
         break;
+      case 'bigint':
+        sqlite3.result_int64(context, value);
+        break;
       case 'string':
         sqlite3.result_text(context, value);
         break;
       default:
         if (value instanceof Int8Array || Array.isArray(value)) {
           sqlite3.result_blob(context, value);
+        } else if (ArrayBuffer.isView(value)) {
+          // Other typed arrays, e.g. from a column aggregate, are
+          // returned as their bytes. A view of WebAssembly memory is
+          // copied first because allocating the result can replace it.
+          const bytes = new Int8Array(value.buffer, value.byteOffset, value.byteLength);
+          sqlite3.result_blob(
+            context,
+            value.buffer === Module.HEAP8.buffer ? bytes.slice() : bytes);
         } else if (value === null) {
           sqlite3.result_null(context);
         } else {
@@ -462,7 +1072,7 @@ export function Factory(Module) {
 
   sqlite3.result_blob = (function() {
     const fname = 'sqlite3_result_blob';
-    const f = Module.cwrap(fname, ...decl('nnnn:n'));
+    const f = Module[`_${fname}`];
     return function(context, value) {
       // @ts-ignore
       const byteLength = value.byteLength ?? value.length;
@@ -474,7 +1084,7 @@ export function Factory(Module) {
 
   sqlite3.result_double = (function() {
     const fname = 'sqlite3_result_double';
-    const f = Module.cwrap(fname, ...decl('nn:n'));
+    const f = Module[`_${fname}`];
     return function(context, value) {
       f(context, value); // void return
     };
@@ -482,15 +1092,23 @@ export function Factory(Module) {
 
   sqlite3.result_int = (function() {
     const fname = 'sqlite3_result_int';
-    const f = Module.cwrap(fname, ...decl('nn:n'));
+    const f = Module[`_${fname}`];
     return function(context, value) {
       f(context, value); // void return
     };
   })();
 
+  sqlite3.result_int64 = (function() {
+    const fname = 'sqlite3_result_int64';
+    const f = Module[`_${fname}`];
+    return function(context, value) {
+      f(context, toBigInt(value)); // void return
+    };
+  })();
+
   sqlite3.result_null = (function() {
     const fname = 'sqlite3_result_null';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
     return function(context) {
       f(context); // void return
     };
@@ -498,7 +1116,7 @@ export function Factory(Module) {
 
   sqlite3.result_text = (function() {
     const fname = 'sqlite3_result_text';
-    const f = Module.cwrap(fname, ...decl('nnnn:n'));
+    const f = Module[`_${fname}`];
     return function(context, value) {
       const ptr = createUTF8(value);
       f(context, ptr, -1, sqliteFreeAddress); // void return
@@ -514,6 +1132,10 @@ export function Factory(Module) {
     return row;
   };
 
+  sqlite3.set_auxdata = function(context, iArg, value) {
+    Module.setAuxData(context, iArg, value);
+  };
+
   sqlite3.sql = (function() {
     const fname = 'sqlite3_sql';
     const f = Module.cwrap(fname, ...decl('n:s'));
@@ -550,11 +1172,96 @@ export function Factory(Module) {
     const f = Module.cwrap(fname, ...decl('n:n'), { async });
     return async function(stmt) {
       verifyStatement(stmt);
+      stmtsDone.delete(stmt);
       const result = await f(stmt);
       return check(fname, result, mapStmtToDB.get(stmt), [SQLite.SQLITE_ROW, SQLite.SQLITE_DONE]);
     };
   })();
 
+  sqlite3.step_sync = (function() {
+    const fname = 'sqlite3_step';
+    const f = syncExport(fname);
+    return function(stmt) {
+      verifyStatement(stmt);
+      stmtsDone.delete(stmt);
+      const result = f(stmt);
+      return check(fname, result, mapStmtToDB.get(stmt), [SQLite.SQLITE_ROW, SQLite.SQLITE_DONE]);
+    };
+  })();
+
+  sqlite3.step_rows = (function() {
+    const fname = 'step_rows';
+    const f = Module.cwrap(fname, ...decl('nnnnn:n'), { async });
+
+    function getRowBuffer(stmt) {
+      let pBuffer = mapStmtToRowBuffer.get(stmt);
+      if (!pBuffer) {
+        pBuffer = Module._malloc(12);
+        Module.setValue(pBuffer, 0, 'i32');
+        Module.setValue(pBuffer + 4, 0, 'i32');
+        mapStmtToRowBuffer.set(stmt, pBuffer);
+      }
+      return pBuffer;
+    }
+
+    return async function(stmt, maxRows = 256, rows = []) {
+      verifyStatement(stmt);
+
+      // Return no rows once after the statement is done, instead of
+      // letting SQLite restart it.
+      if (stmtsDone.delete(stmt)) {
+        rows.length = 0;
+        return rows;
+      }
+
+      const pBuffer = getRowBuffer(stmt);
+      const pnRows = pBuffer + 8;
+      const result = await f(stmt, maxRows, pBuffer, pBuffer + 4, pnRows);
+      check('sqlite3_step', result, mapStmtToDB.get(stmt), [SQLite.SQLITE_ROW, SQLite.SQLITE_DONE]);
+      if (result === SQLite.SQLITE_DONE) stmtsDone.add(stmt);
+
+      // Decode the packed values (see librows.c).
+      const nRows = Module.getValue(pnRows, 'i32');
+      const nColumns = sqlite3.column_count(stmt);
+      const view = new DataView(Module.HEAPU8.buffer);
+      const bigint = bigintDatabases.has(mapStmtToDB.get(stmt));
+      let offset = Module.getValue(pBuffer, 'i32');
+
+      // Row arrays passed in are reused.
+      rows.length = nRows;
+      for (let i = 0; i < nRows; ++i) {
+        const row = rows[i] = rows[i] ?? new Array(nColumns);
+        row.length = nColumns;
+        for (let j = 0; j < nColumns; ++j) {
+          const type = view.getInt32(offset, true);
+          const nBytes = view.getInt32(offset + 4, true);
+          offset += 8;
+          switch (type) {
+            case SQLite.SQLITE_INTEGER:
+              row[j] = bigint ?
+                view.getBigInt64(offset, true) :
+                view.getInt32(offset + 4, true) * 0x100000000 + view.getUint32(offset, true);
+              break;
+            case SQLite.SQLITE_FLOAT:
+              row[j] = view.getFloat64(offset, true);
+              break;
+            case SQLite.SQLITE_TEXT:
+              row[j] = decodeUTF8(offset, nBytes);
+              break;
+            case SQLite.SQLITE_BLOB:
+              row[j] = Module.HEAP8.slice(offset, offset + nBytes);
+              break;
+            default:
+              row[j] = null;
+              break;
+          }
+          offset += (nBytes + 7) & ~7;
+        }
+      }
+      return rows;
+    };
+  })();
+
   // Duplicate some of the SQLite dynamic string API but without
   // calling SQLite (except for memory allocation). We need some way
   // to transfer Javascript strings and might as well use an API
@@ -562,12 +1269,28 @@ export function Factory(Module) {
   let stringId = 0;
   const strings = new Map();
 
+  sqlite3.stream = function(db, sql, batchSize = 256) {
+    return (async function*() {
+      // The batch object and row arrays are reused, so only one batch
+      // of rows is held at a time. The next batch is not read until the
+      // consumer asks for it.
+      const batch = { columns: [], rows: [] };
+      for await (const stmt of sqlite3.statements(db, sql)) {
+        batch.columns = sqlite3.column_names(stmt);
+        while ((await sqlite3.step_rows(stmt, batchSize, batch.rows)).length) {
+          yield batch;
+        }
+      }
+    })();
+  };
+
   sqlite3.str_new = function(db, s = '') {
     const sBytes = Module.lengthBytesUTF8(s);
     const str = stringId++ & 0xffffffff;
     const data = {
       offset: Module._sqlite3_malloc(sBytes + 1),
-      bytes: sBytes
+      bytes: sBytes,
+      capacity: sBytes + 1
     };
     strings.set(str, data);
     Module.stringToUTF8(s, data.offset, data.bytes + 1);
@@ -580,17 +1303,21 @@ export function Factory(Module) {
     }
     const data = strings.get(str);
 
+    // Grow the capacity geometrically so repeated appends take linear
+    // time overall.
     const sBytes = Module.lengthBytesUTF8(s);
     const newBytes = data.bytes + sBytes;
-    const newOffset = Module._sqlite3_malloc(newBytes + 1);
-    const newArray = Module.HEAP8.subarray(newOffset, newOffset + newBytes + 1);
-    newArray.set(Module.HEAP8.subarray(data.offset, data.offset + data.bytes));
-    Module.stringToUTF8(s, newOffset + data.bytes, sBytes + 1);
-
-    Module._sqlite3_free(data.offset);
-    data.offset = newOffset;
+    if (newBytes + 1 > data.capacity) {
+      const capacity = Math.max(newBytes + 1, data.capacity * 2);
+      const newOffset = Module._sqlite3_realloc(data.offset, capacity);
+      if (!newOffset) {
+        throw new SQLiteError('out of memory', SQLite.SQLITE_NOMEM);
+      }
+      data.offset = newOffset;
+      data.capacity = capacity;
+    }
+    Module.stringToUTF8(s, data.offset + data.bytes, sBytes + 1);
     data.bytes = newBytes;
-    strings.set(str, data);
   };
 
   sqlite3.str_finish = function(str) {
@@ -609,19 +1336,28 @@ export function Factory(Module) {
     return strings.get(str).offset;
   };
 
+  sqlite3.use_bigint = function(db, enable = true) {
+    verifyDatabase(db);
+    if (enable) {
+      bigintDatabases.add(db);
+    } else {
+      bigintDatabases.delete(db);
+    }
+  };
+
   sqlite3.user_data = function(context) {
     return Module.getFunctionUserData(context);
   };
 
   sqlite3.value = function(pValue) {
-    const type = sqlite3.value_type(pValue);
+    const type = Module._sqlite3_value_type(pValue);
     switch (type) {
       case SQLite.SQLITE_BLOB:
         return sqlite3.value_blob(pValue);
       case SQLite.SQLITE_FLOAT:
-        return sqlite3.value_double(pValue);
+        return Module._sqlite3_value_double(pValue);
       case SQLite.SQLITE_INTEGER:
-        return sqlite3.value_int(pValue);
+        return Module._sqlite3_value_double(pValue);
       case SQLite.SQLITE_NULL:
         return null;
       case SQLite.SQLITE_TEXT:
@@ -633,7 +1369,7 @@ export function Factory(Module) {
 
   sqlite3.value_blob = (function() {
     const fname = 'sqlite3_value_blob';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
     return function(pValue) {
       const nBytes = sqlite3.value_bytes(pValue);
       const address = f(pValue);
@@ -645,7 +1381,7 @@ export function Factory(Module) {
 
   sqlite3.value_bytes = (function() {
     const fname = 'sqlite3_value_bytes';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
     return function(pValue) {
       const result = f(pValue);
       // trace(fname, result);
@@ -655,7 +1391,7 @@ export function Factory(Module) {
 
   sqlite3.value_double = (function() {
     const fname = 'sqlite3_value_double';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
     return function(pValue) {
       const result = f(pValue);
       // trace(fname, result);
@@ -665,7 +1401,17 @@ export function Factory(Module) {
 
   sqlite3.value_int = (function() {
     const fname = 'sqlite3_value_int';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
+    return function(pValue) {
+      const result = f(pValue);
+      // trace(fname, result);
+      return result;
+    };
+  })();
+
+  sqlite3.value_int64 = (function() {
+    const fname = 'sqlite3_value_int64';
+    const f = Module[`_${fname}`];
     return function(pValue) {
       const result = f(pValue);
       // trace(fname, result);
@@ -675,9 +1421,11 @@ export function Factory(Module) {
 
   sqlite3.value_text = (function() {
     const fname = 'sqlite3_value_text';
-    const f = Module.cwrap(fname, ...decl('n:s'));
+    const f = Module[`_${fname}`];
     return function(pValue) {
-      const result = f(pValue);
+      const address = f(pValue);
+      const nBytes = Module._sqlite3_value_bytes(pValue);
+      const result = decodeUTF8(address, nBytes);
       // trace(fname, result);
       return result;
     };
@@ -685,7 +1433,7 @@ export function Factory(Module) {
 
   sqlite3.value_type = (function() {
     const fname = 'sqlite3_value_type';
-    const f = Module.cwrap(fname, ...decl('n:n'));
+    const f = Module[`_${fname}`];
     return function(pValue) {
       const result = f(pValue);
       // trace(fname, result);
@@ -102,6 +102,14 @@ export const SQLITE_LOCK_RESERVED = 2;
 export const SQLITE_LOCK_PENDING = 3;
 export const SQLITE_LOCK_EXCLUSIVE = 4;
 
+// Shared memory lock flags.
+// https://www.sqlite.org/c3ref/c_shm_exclusive.html
+export const SQLITE_SHM_UNLOCK = 1;
+export const SQLITE_SHM_LOCK = 2;
+export const SQLITE_SHM_SHARED = 4;
+export const SQLITE_SHM_EXCLUSIVE = 8;
+export const SQLITE_SHM_NLOCK = 8;
+
 // Device characteristics.
 // https://www.sqlite.org/c3ref/c_iocap_atomic.html
 export const SQLITE_IOCAP_ATOMIC = 0x00000001;
@@ -15,7 +15,7 @@
  * each element converted to a byte); SQLite always returns blob data as
  * `Int8Array`
  */
-type SQLiteCompatibleType = number|string|Int8Array|Array<number>|null;
+type SQLiteCompatibleType = number|bigint|string|Int8Array|Array<number>|null;
 
 /**
  * SQLite Virtual File System object
@@ -30,6 +30,11 @@ type SQLiteCompatibleType = number|string|Int8Array|Array<number>|null;
  * and
  * [IndexedDbVFS.js](https://github.com/rhashimoto/wa-sqlite/blob/master/src/examples/IndexedDbVFS.js).
  * 
+ * Argument objects like `pData` and `pResOut` are reused across calls,
+ * so they (and the typed arrays they provide) must not be retained after
+ * a method returns or its Promise settles. Copy data that is needed
+ * later, e.g. with `pData.value.slice()`.
+ * 
  * @see https://sqlite.org/vfs.html
  * @see https://sqlite.org/c3ref/io_methods.html
  */
@@ -37,6 +42,21 @@ declare interface SQLiteVFS {
   /** Maximum length of a file path in UTF-8 bytes (default 64) */
   mxPathName?: number;
 
+  /**
+   * Bytes to reserve for the VFS in each SQLite file object (default 0),
+   * which can be located with the `fileData()` method injected on
+   * registration.
+   */
+  fileDataSize?: number;
+
+  /**
+   * If true, `xFileSize()` results for database files are cached
+   * between locks and updated on `xWrite()`. Only set this if file size
+   * cannot otherwise change while a lock is held. WAL and journal file
+   * sizes are never cached.
+   */
+  cacheFileSize?: boolean;
+
   /** @see https://sqlite.org/c3ref/io_methods.html */
   xClose(fileId: number): number|Promise<number>;
 
@@ -47,6 +67,18 @@ declare interface SQLiteVFS {
     iOffset: number
   ): number|Promise<number>;
 
+  /**
+   * Optional hint that data in the given range will likely be read soon,
+   * called when SQLite reads a file sequentially. The VFS may prefetch
+   * the data so subsequent `xRead()` calls can complete without waiting.
+   * The return value is ignored.
+   */
+  xReadAhead?(
+    fileId: number,
+    iOffset: number,
+    iAmt: number
+  ): number|Promise<number>;
+
   /** @see https://sqlite.org/c3ref/io_methods.html */
   xWrite(
     fileId: number,
@@ -54,11 +86,22 @@ declare interface SQLiteVFS {
     iOffset: number
   ): number|Promise<number>;
 
+  /**
+   * Optional batched write. If defined, writes are buffered and passed
+   * together in a single call, in order, before any other call for the
+   * file (`xWrite()` is not called). The `data` arrays are views of
+   * WebAssembly memory that are only valid for the duration of the call.
+   */
+  xWriteBatch?(
+    fileId: number,
+    writes: { offset: number, data: Int8Array }[]
+  ): number|Promise<number>;
+
   /** @see https://sqlite.org/c3ref/io_methods.html */
   xTruncate(fileId: number, iSize: number): number|Promise<number>;
 
   /** @see https://sqlite.org/c3ref/io_methods.html */
-  xSync(fileId: number, flags: number): number|Promise<number>;
+  xSync?(fileId: number, flags: number): number|Promise<number>;
 
   /** @see https://sqlite.org/c3ref/io_methods.html */
   xFileSize(
@@ -67,26 +110,80 @@ declare interface SQLiteVFS {
   ): number|Promise<number>;
 
   /** @see https://sqlite.org/c3ref/io_methods.html */
-  xLock(fileId: number, flags: number): number|Promise<number>;
+  xLock?(fileId: number, flags: number): number|Promise<number>;
 
   /** @see https://sqlite.org/c3ref/io_methods.html */
-  xUnlock(fileId: number, flags: number): number|Promise<number>;
+  xUnlock?(fileId: number, flags: number): number|Promise<number>;
 
   /** @see https://sqlite.org/c3ref/io_methods.html */
-  xCheckReservedLock(
+  xCheckReservedLock?(
     fileId: number,
     pResOut: { set(value: number): void }
   ): number|Promise<number>;
 
   /** @see https://sqlite.org/c3ref/io_methods.html */
-  xFileControl(
+  xFileControl?(
     fileId: number,
     flags: number,
     pOut: { value: Int8Array }
   ): number|Promise<number>;
 
   /** @see https://sqlite.org/c3ref/io_methods.html */
-  xDeviceCharacteristics(fileId: number): number|Promise<number>;
+  xSectorSize?(fileId: number): number|Promise<number>;
+
+  /** @see https://sqlite.org/c3ref/io_methods.html */
+  xDeviceCharacteristics?(fileId: number): number|Promise<number>;
+
+  /**
+   * Defining this method enables WAL mode for the VFS. The WAL index
+   * is kept in the WebAssembly heap and is only shared by connections
+   * in the same context. This method is called after each region is
+   * mapped.
+   * @see https://sqlite.org/c3ref/io_methods.html
+   */
+  xShmMap?(
+    fileId: number,
+    iRegion: number,
+    szRegion: number,
+    bExtend: number,
+    pData: { size: number, value: Int8Array }
+  ): number|Promise<number>;
+
+  /**
+   * Called after a WAL index lock is acquired or released in the
+   * WebAssembly heap. Returning an error (e.g. `SQLITE_BUSY`) from an
+   * acquire undoes it.
+   * @see https://sqlite.org/c3ref/io_methods.html
+   */
+  xShmLock?(
+    fileId: number,
+    offset: number,
+    n: number,
+    flags: number
+  ): number|Promise<number>;
+
+  /** @see https://sqlite.org/c3ref/io_methods.html */
+  xShmBarrier?(fileId: number): void;
+
+  /** @see https://sqlite.org/c3ref/io_methods.html */
+  xShmUnmap?(fileId: number, deleteFlag: number): number|Promise<number>;
+
+  /**
+   * Defining this method enables memory-mapped I/O (with
+   * `PRAGMA mmap_size`). The pointer set in `pp` must address file data
+   * in the WebAssembly heap that remains valid until the corresponding
+   * {@link xUnfetch}, or 0 if the data cannot be mapped.
+   * @see https://sqlite.org/c3ref/io_methods.html
+   */
+  xFetch?(
+    fileId: number,
+    iOffset: number,
+    iAmt: number,
+    pp: { set(value: number): void }
+  ): number|Promise<number>;
+
+  /** @see https://sqlite.org/c3ref/io_methods.html */
+  xUnfetch?(fileId: number, iOffset: number, pData: number): number|Promise<number>;
 
   /** @see https://sqlite.org/c3ref/vfs.html */
   xOpen(
@@ -305,6 +402,48 @@ declare interface SQLiteModule {
  * @see https://sqlite.org/c3ref/funclist.html
  */
 declare interface SQLiteAPI {
+  /**
+   * Get memory for the state of an aggregate function invocation
+   * 
+   * The memory is allocated by SQLite, zero-filled, on the first call
+   * with `nBytes` > 0 for an invocation and freed after its final
+   * callback, even if the statement fails. Using it instead of
+   * Javascript state keyed by context avoids both a lookup per row and
+   * leaks when the final callback is not reached in Javascript.
+   * @see https://sqlite.org/c3ref/aggregate_context.html
+   * @param context context pointer
+   * @param nBytes size of the state
+   * @returns pointer to the state, or 0 if it could not be allocated or
+   * `nBytes` is 0 and no state exists
+   */
+  aggregate_context(context: number, nBytes: number): number;
+
+  /**
+   * Get aggregate function state as an array of numbers
+   * 
+   * This calls {@link aggregate_context} for `nValues` doubles and
+   * returns a view of them, which is valid only during the callback.
+   * Values start at zero and persist across callbacks for the same
+   * invocation, so numeric accumulators can be kept directly in it:
+   * ```
+   * function xStep(context, values) {
+   *   const state = sqlite3.aggregate_context_f64(context, 2);
+   *   state[0] += sqlite3.value_double(values[0]);
+   *   state[1]++;
+   * }
+   * function xFinal(context) {
+   *   const state = sqlite3.aggregate_context_f64(context, 2);
+   *   sqlite3.result(context, state[1] ? state[0] / state[1] : null);
+   * }
+   * ```
+   * @param context context pointer
+   * @param nValues number of values, or 0 to check for existing state
+   * without allocating it
+   * @returns view of the state, or `null` if `nValues` is 0 and no state
+   * exists (throws exception if allocation fails)
+   */
+  aggregate_context_f64(context: number, nValues: number): Float64Array|null;
+
   /**
    * Bind a collection of values to a statement
    * 
@@ -396,6 +535,18 @@ declare interface SQLiteAPI {
    */
   bind_int(stmt: number, i: number, value: number): number;
 
+   /**
+   * Bind 64-bit integer to prepared statement parameter
+   * 
+   * Note that binding indices begin with 1.
+   * @see https://www.sqlite.org/c3ref/bind_blob.html
+   * @param stmt prepared statement pointer
+   * @param i binding index
+   * @param value integer, or number truncated to an integer
+   * @returns `SQLITE_OK` (throws exception on error)
+   */
+  bind_int64(stmt: number, i: number, value: bigint|number): number;
+
    /**
    * Bind null to prepared statement
    * 
@@ -454,11 +605,21 @@ declare interface SQLiteAPI {
    */
   close(db): Promise<number>;
 
+  /**
+   * Synchronous variant of {@link close} for a module built without
+   * Asyncify or JSPI (throws with any other module)
+   * @param db database pointer
+   * @returns `SQLITE_OK` (throws exception on error)
+   */
+  close_sync(db: number): number;
+
   /**
    * Call the appropriate `column_*` function based on the column type
    * 
    * The type is determined by calling {@link column_type}, which may
-   * not match the type declared in `CREATE TABLE`.
+   * not match the type declared in `CREATE TABLE`. INTEGER values are
+   * returned as `number` (exact up to 2^53) unless {@link use_bigint}
+   * is enabled for the database.
    * @param stmt prepared statement pointer
    * @param i column index
    * @returns column value
@@ -513,6 +674,15 @@ declare interface SQLiteAPI {
    */
   column_int(stmt: number, i: number): number;
 
+  /**
+   * Extract a column value from a row after a prepared statment {@link step}
+   * @see https://www.sqlite.org/c3ref/column_blob.html
+   * @param stmt prepared statement pointer
+   * @param i column index
+   * @returns column value
+   */
+  column_int64(stmt: number, i: number): bigint;
+
   /**
    * Get a column name for a prepared statement
    * @see https://www.sqlite.org/c3ref/column_blob.html
@@ -552,13 +722,67 @@ declare interface SQLiteAPI {
    */
   column_type(stmt: number, i: number): number;
 
+  /**
+   * Create or redefine an SQL aggregate function over columns
+   * 
+   * This is an API convenience function not in the C API. A column
+   * aggregate is an aggregate function whose arguments are collected in
+   * C as numbers (`NaN` for NULL, and as `sqlite3_value_double` converts
+   * other values) for all the rows in a group. Instead of a step call
+   * per row, `xFinal` is called once per group with a `Float64Array`
+   * for each argument, so a numeric reduction runs over whole columns.
+   * The arrays are views of WebAssembly memory that are valid only
+   * during the call, and are empty for a group with no rows.
+   * 
+   * `xFinal` sets the single result for the group with {@link result},
+   * which can be a typed array returned as a BLOB. The number of
+   * buffered values in a group (rows times arguments) is limited to
+   * 2^24; a larger group fails with `SQLITE_TOOBIG`.
+   * ```
+   * sqlite3.create_column_aggregate(db, 'dot', 2, SQLite.SQLITE_UTF8, 0,
+   *   (context, [a, b]) => {
+   *     let sum = 0;
+   *     for (let i = 0; i < a.length; ++i) sum += a[i] * b[i];
+   *     sqlite3.result(context, sum);
+   *   });
+   * ```
+   * @see https://sqlite.org/c3ref/create_function.html
+   * @param db database pointer
+   * @param zFunctionName 
+   * @param nArg number of function arguments, at least 1
+   * @param eTextRep text encoding and function flags
+   * @param pApp application data
+   * @param xFinal 
+   * @returns `SQLITE_OK` (throws exception on error)
+   */
+  create_column_aggregate(
+    db: number,
+    zFunctionName: string,
+    nArg: number,
+    eTextRep: number,
+    pApp: number,
+    xFinal: (context: number, columns: Float64Array[]) => void): number;
+
   /**
    * Create or redefine SQL functions
+   * 
+   * The `eTextRep` argument can include function flags as well as the
+   * text encoding. A function whose result depends only on its
+   * arguments should include `SQLITE_DETERMINISTIC`, which allows
+   * SQLite to evaluate it once for constant arguments and to use it in
+   * indexes on expressions:
+   * ```
+   * sqlite3.create_function(
+   *   db, 'myfunc', 1,
+   *   SQLite.SQLITE_UTF8 | SQLite.SQLITE_DETERMINISTIC | SQLite.SQLITE_INNOCUOUS,
+   *   0, xFunc);
+   * ```
    * @see https://sqlite.org/c3ref/create_function.html
+   * @see https://sqlite.org/c3ref/c_deterministic.html
    * @param db database pointer
    * @param zFunctionName 
    * @param nArg number of function arguments
-   * @param eTextRep text encoding (and other flags)
+   * @param eTextRep text encoding and function flags
    * @param pApp application data
    * @param xFunc 
    * @param xStep 
@@ -575,6 +799,34 @@ declare interface SQLiteAPI {
     xStep?: (context: number, values: Uint32Array) => void,
     xFinal?: (context: number) => void): number;
 
+  /**
+   * Create or redefine an SQL scalar function that receives argument
+   * values instead of pointers
+   * 
+   * This is an API convenience function not in the C API. The argument
+   * types and values are decoded in C and read from WebAssembly memory
+   * in one pass, which avoids the calls into WebAssembly that
+   * {@link value} makes for each argument. INTEGER and FLOAT arguments
+   * are `number`, TEXT is `string`, BLOB is an `Int8Array` view of
+   * WebAssembly memory that is valid only during the call, and NULL is
+   * `null`. The argument array is reused for every call.
+   * @see https://sqlite.org/c3ref/create_function.html
+   * @param db database pointer
+   * @param zFunctionName 
+   * @param nArg number of function arguments
+   * @param eTextRep text encoding and function flags
+   * @param pApp application data
+   * @param xFunc 
+   * @returns `SQLITE_OK` (throws exception on error)
+   */
+  create_function_decoded(
+    db: number,
+    zFunctionName: string,
+    nArg: number,
+    eTextRep: number,
+    pApp: number,
+    xFunc: (context: number, args: Array<number|string|Int8Array|null>) => void): number;
+
   /**
    * Create a SQLite module for virtual tables
    * @see https://www.sqlite.org/c3ref/create_module.html
@@ -586,6 +838,37 @@ declare interface SQLiteAPI {
    */
   create_module(db: number, zName: string, module: SQLiteModule, appData?): number;
 
+  /**
+   * Create or redefine SQL aggregate window functions
+   * 
+   * In addition to the aggregate callbacks, `xValue` returns the
+   * current value of the aggregate and `xInverse` removes a row from
+   * the window, so sliding frames are computed incrementally instead of
+   * from the whole frame for each row. As with aggregate functions, the
+   * context pointer identifies the invocation.
+   * @see https://sqlite.org/c3ref/create_function.html
+   * @param db database pointer
+   * @param zFunctionName 
+   * @param nArg number of function arguments
+   * @param eTextRep text encoding (and other flags)
+   * @param pApp application data
+   * @param xStep 
+   * @param xFinal 
+   * @param xValue 
+   * @param xInverse 
+   * @returns `SQLITE_OK` (throws exception on error)
+   */
+  create_window_function(
+    db: number,
+    zFunctionName: string,
+    nArg: number,
+    eTextRep: number,
+    pApp: number,
+    xStep: (context: number, values: Uint32Array) => void,
+    xFinal: (context: number) => void,
+    xValue: (context: number) => void,
+    xInverse: (context: number, values: Uint32Array) => void): number;
+
   /**
    * Get number of columns in current row of a prepared statement
    * @see https://www.sqlite.org/c3ref/data_count.html
@@ -616,6 +899,56 @@ declare interface SQLiteAPI {
    */
   finalize(stmt: number): Promise<number>;
 
+  /**
+   * Synchronous variant of {@link finalize} for a module built without
+   * Asyncify or JSPI (throws with any other module)
+   * @param stmt prepared statement pointer
+   * @returns `SQLITE_OK` (throws exception on error)
+   */
+  finalize_sync(stmt: number): number;
+
+  /**
+   * Get auxiliary data previously associated with a function argument
+   * by {@link set_auxdata}
+   * @see https://sqlite.org/c3ref/get_auxdata.html
+   * @param context context pointer
+   * @param iArg argument index
+   * @returns the associated value, or `undefined` if none
+   */
+  get_auxdata(context: number, iArg: number): any;
+
+  /**
+   * Execute a statement once for each row of parameter values
+   * 
+   * This is an API convenience function not in the C API. The rows are
+   * packed into WebAssembly memory and bound, stepped, and reset in a
+   * loop in C, instead of crossing between Javascript and WebAssembly
+   * for each value and row. Each row is an array or an object keyed by
+   * parameter name, as with {@link bind_collection}, and values are
+   * converted as with {@link bind}. Missing values are bound as `NULL`.
+   * Any rows returned by the statement are discarded.
+   * 
+   * All bindings are cleared on return. On error, rows before the
+   * failing row have been executed, so callers usually wrap this call
+   * in a transaction. If a row fails to execute, the number of rows
+   * executed is the `rowsDone` property of the thrown
+   * {@link SQLiteError}.
+   * ```javascript
+   * await sqlite3.exec(db, 'BEGIN');
+   * for await (const stmt of sqlite3.statements(db, 'INSERT INTO t VALUES (?, ?)')) {
+   *   await sqlite3.insert_many(stmt, [[1, 'foo'], [2, 'bar']]);
+   * }
+   * await sqlite3.exec(db, 'COMMIT');
+   * ```
+   * @param stmt prepared statement pointer
+   * @param rows parameter values for each execution
+   * @returns Promise-wrapped `SQLITE_OK` (rejects on error)
+   */
+  insert_many(
+    stmt: number,
+    rows: Array<Array<SQLiteCompatibleType|null>|{[index: string]: SQLiteCompatibleType|null}>
+  ): Promise<number>;
+
   /**
    * Get SQLite library version
    * @see https://www.sqlite.org/c3ref/libversion.html
@@ -648,6 +981,20 @@ declare interface SQLiteAPI {
     zVfs?: string    
   ): Promise<number>;
 
+  /**
+   * Synchronous variant of {@link open_v2} for a module built without
+   * Asyncify or JSPI (throws with any other module)
+   * @param zFilename 
+   * @param iFlags `SQLite.CREATE | SQLite.READWRITE` (0x6) if omitted
+   * @param zVfs VFS name
+   * @returns database pointer (throws exception on error)
+   */
+  open_v2_sync(
+    zFilename: string,
+    iFlags?: number,
+    zVfs?: string
+  ): number;
+
   /**
    * Compile an SQL statement
    * 
@@ -693,6 +1040,63 @@ declare interface SQLiteAPI {
    */
   prepare_v2(db: number, sql: number): Promise<{ stmt: number, sql: number}|null>;
 
+  /**
+   * Synchronous variant of {@link prepare_v2} for a module built without
+   * Asyncify or JSPI (throws with any other module)
+   * @param db database pointer
+   * @param sql SQL pointer
+   * @returns object containing the prepared statement pointer and next
+   * SQL pointer, or `null` when no statement remains
+   */
+  prepare_v2_sync(db: number, sql: number): { stmt: number, sql: number}|null;
+
+  /**
+   * Compile the first SQL statement in a string, using a per-database
+   * cache keyed by SQL text
+   * 
+   * This is an API convenience function not in the C API. When `sql`
+   * has been prepared before, the cached statement is reset and
+   * returned without copying or parsing the SQL again. Bindings are
+   * not cleared. Cached statements are reprepared by SQLite when the
+   * schema changes. If every cached statement for `sql` is still being
+   * stepped (e.g. nested use of the same SQL), another statement is
+   * prepared and added to the cache instead of resetting one in use.
+   * 
+   * The returned object contains the prepared statement and the
+   * remaining uncompiled SQL text, which can be passed to the next
+   * call to this function:
+   * ```javascript
+   * let prepared = { stmt: null, tail: sql };
+   * while (prepared.tail &&
+   *        (prepared = await sqlite3.prepare_cached(db, prepared.tail))) {
+   *   while (await sqlite3.step(prepared.stmt) === SQLite.SQLITE_ROW) {
+   *     // Do something with the row data...
+   *   }
+   * }
+   * ```
+   * 
+   * Statements are owned by the cache and are finalized when they are
+   * evicted as least recently used or when the database is closed.
+   * A statement evicted while it is still being stepped is finalized
+   * by the first call that uses the cache after it is done or reset.
+   * A statement should not be kept across calls that may evict it
+   * except while it is being stepped.
+   * @param db database pointer
+   * @param sql SQL text
+   * @returns Promise-wrapped object containing the prepared statement
+   * pointer and remaining SQL text, or a Promise containing `null` when
+   * `sql` contains no statement
+   */
+  prepare_cached(db: number, sql: string): Promise<{ stmt: number, tail: string }|null>;
+
+  /**
+   * Set the maximum number of statements kept by {@link prepare_cached}
+   * for a database (default 64), finalizing any excess
+   * @param db database pointer
+   * @param capacity maximum number of cached statements, at least 1
+   */
+  prepare_cache_size(db: number, capacity: number): Promise<void>;
+
   /**
    * Reset a prepared statement object
    * @see https://www.sqlite.org/c3ref/reset.html
@@ -701,12 +1105,23 @@ declare interface SQLiteAPI {
    */
   reset(stmt: number): Promise<number>;
 
+  /**
+   * Synchronous variant of {@link reset} for a module built without
+   * Asyncify or JSPI (throws with any other module)
+   * @param stmt prepared statement pointer
+   * @returns `SQLITE_OK` (throws exception on error)
+   */
+  reset_sync(stmt: number): number;
+
   /**
    * Convenience function to call `result_*` based of the type of `value`
+   * 
+   * Typed arrays other than `Int8Array` are returned as a BLOB of their
+   * bytes.
    * @param context context pointer
    * @param value 
    */
-  result(context: number, value: (SQLiteCompatibleType|number[])|null): void;
+  result(context: number, value: (SQLiteCompatibleType|number[]|ArrayBufferView)|null): void;
 
   /**
    * Set the result of a function or vtable column
@@ -732,6 +1147,14 @@ declare interface SQLiteAPI {
    */
   result_int(context: number, value: number): void;
 
+  /**
+   * Set the result of a function or vtable column
+   * @see https://sqlite.org/c3ref/result_blob.html
+   * @param context context pointer
+   * @param value integer, or number truncated to an integer
+   */
+  result_int64(context: number, value: bigint|number): void;
+
   /**
    * Set the result of a function or vtable column
    * @see https://sqlite.org/c3ref/result_blob.html
@@ -762,6 +1185,21 @@ declare interface SQLiteAPI {
    */
   sql(stmt: number): string;
 
+  /**
+   * Associate a Javascript value with a function argument
+   * 
+   * SQLite keeps the association while the argument is unchanged, e.g.
+   * a constant argument over all the rows of a statement, so a function
+   * can cache work like a compiled regular expression derived from that
+   * argument. SQLite may discard the value at any time, so the function
+   * must be prepared to recompute it.
+   * @see https://sqlite.org/c3ref/get_auxdata.html
+   * @param context context pointer
+   * @param iArg argument index
+   * @param value 
+   */
+  set_auxdata(context: number, iArg: number, value: any): void;
+
   /**
    * SQL statement iterator
    * 
@@ -809,6 +1247,69 @@ declare interface SQLiteAPI {
    */
   step(stmt: number): Promise<number>;
 
+  /**
+   * Synchronous variant of {@link step} for a module built without
+   * Asyncify or JSPI (throws with any other module)
+   * 
+   * Stepping through rows without awaiting a Promise for each row can
+   * be much faster for CPU-bound queries.
+   * @param stmt prepared statement pointer
+   * @returns `SQLITE_ROW` or `SQLITE_DONE` (throws exception on error)
+   */
+  step_sync(stmt: number): number;
+
+  /**
+   * Evaluate an SQL statement for multiple rows
+   * 
+   * This steps the statement up to `maxRows` times and returns the
+   * data for all the rows, with far fewer calls into WebAssembly than
+   * {@link step} and {@link row} for each row. Once the statement is
+   * done, the next call returns an empty array.
+   * ```
+   * let rows;
+   * while ((rows = await sqlite3.step_rows(stmt)).length) {
+   *   // Process rows.
+   * }
+   * ```
+   * @param stmt prepared statement pointer
+   * @param maxRows maximum number of rows to return, default 256
+   * @param rows optional array to fill and return, reusing its row
+   * arrays, instead of allocating new ones
+   * @returns Promise resolving to an array of rows (rejects on error)
+   */
+  step_rows(
+    stmt: number,
+    maxRows?: number,
+    rows?: Array<Array<SQLiteCompatibleType|null>>
+  ): Promise<Array<Array<SQLiteCompatibleType|null>>>;
+
+  /**
+   * Stream the results of SQL statements in batches of rows
+   * 
+   * This is an API convenience function not in the C API. It returns
+   * an async iterator that yields an object with the column names and
+   * up to `batchSize` rows of the current statement. Rows are only read
+   * when the consumer requests the next batch, so large results can be
+   * processed in bounded memory.
+   * 
+   * The same batch object and row arrays are reused for every batch,
+   * so copy any data that must be retained past the next iteration.
+   * ```
+   * for await (const { columns, rows } of sqlite3.stream(db, sql)) {
+   *   // Process rows.
+   * }
+   * ```
+   * Breaking out of the loop finalizes the current statement, as with
+   * {@link statements}.
+   * @param db database pointer
+   * @param sql
+   * @param batchSize maximum number of rows per batch, default 256
+   */
+  stream(db: number, sql: string, batchSize?: number): AsyncIterable<{
+    columns: string[],
+    rows: Array<Array<SQLiteCompatibleType|null>>
+  }>;
+
   /**
    * Create a new `sqlite3_str` dynamic string instance
    * 
@@ -869,6 +1370,17 @@ declare interface SQLiteAPI {
    */
   user_data(context: number): any;
 
+  /**
+   * Select how INTEGER values are returned by {@link column}, {@link row}
+   * and {@link step_rows} for a database
+   * 
+   * By default INTEGER values are returned as `number`, which is exact
+   * up to 2^53. If enabled, they are returned as `bigint` instead.
+   * @param db database pointer
+   * @param enable default `true`
+   */
+  use_bigint(db: number, enable?: boolean): void;
+
   /**
    * Extract a value from `sqlite3_value`
    * 
@@ -915,6 +1427,14 @@ declare interface SQLiteAPI {
    */
   value_int(pValue: number): number;
 
+  /**
+   * Extract a value from `sqlite3_value`
+   * @see https://sqlite.org/c3ref/value_blob.html
+   * @param pValue `sqlite3_value` pointer
+   * @returns value
+   */
+  value_int64(pValue: number): bigint;
+
   /**
    * Extract a value from `sqlite3_value`
    * @see https://sqlite.org/c3ref/value_blob.html
@@ -1035,6 +1555,11 @@ declare module 'wa-sqlite/src/sqlite-constants.js' {
   export const SQLITE_LOCK_RESERVED: 2;
   export const SQLITE_LOCK_PENDING: 3;
   export const SQLITE_LOCK_EXCLUSIVE: 4;
+  export const SQLITE_SHM_UNLOCK: 1;
+  export const SQLITE_SHM_LOCK: 2;
+  export const SQLITE_SHM_SHARED: 4;
+  export const SQLITE_SHM_EXCLUSIVE: 8;
+  export const SQLITE_SHM_NLOCK: 8;
   export const SQLITE_IOCAP_ATOMIC: 1;
   export const SQLITE_IOCAP_ATOMIC512: 2;
   export const SQLITE_IOCAP_ATOMIC1K: 4;
@@ -1140,6 +1665,8 @@ declare module 'wa-sqlite' {
   export class SQLiteError extends Error {
       constructor(message: any, code: any);
       code: any;
+      /** Rows executed before the error, set by `insert_many` */
+      rowsDone?: number;
   }
 }
 
@@ -1161,6 +1688,19 @@ declare module 'wa-sqlite/src/VFS.js' {
 
   export class Base {
     mxPathName: number;
+    /**
+     * WebAssembly heap access, injected on registration.
+     */
+    heap: {
+      malloc(size: number): number;
+      free(ptr: number): void;
+      readonly HEAP8: Int8Array;
+      readonly HEAPU8: Uint8Array;
+    }|null;
+    /** Bytes reserved for the VFS in each SQLite file object */
+    fileDataSize: number;
+    /** Allow SQLite to cache file size between locks */
+    cacheFileSize: boolean;
     /**
      * @param {number} fileId
      * @returns {number|Promise<number>}
@@ -1271,6 +1811,14 @@ declare module 'wa-sqlite/src/VFS.js' {
     xAccess(name: string, flags: number, pResOut: {
         set: (arg0: number) => void;
     }): number | Promise<number>;
+    /**
+     * Get the address of the fileDataSize bytes reserved for the VFS in
+     * an SQLite file object. This implementation will be overridden on
+     * registration.
+     * @param {number} fileId
+     * @returns {number}
+     */
+    fileData(fileId: number): number;
     /**
      * Handle asynchronous operation. This implementation will be overriden on
      * registration by an Asyncify build.
@@ -1465,6 +2013,16 @@ declare module 'wa-sqlite/src/examples/MemoryVFS.js' {
   }
 }
 
+/** @ignore */
+declare module 'wa-sqlite/src/examples/MemoryHeapVFS.js' {
+  import * as VFS from "wa-sqlite/src/VFS.js";
+  export class MemoryHeapVFS extends VFS.Base {
+    name: string;
+    mapNameToFile: Map<any, any>;
+    mapIdToFile: Map<any, any>;
+  }
+}
+
 /** @ignore */
 declare module 'wa-sqlite/src/examples/MemoryAsyncVFS.js' {
   import { MemoryVFS } from "wa-sqlite/src/examples/MemoryVFS.js";
@@ -1,8 +1,9 @@
-import { getSQLite, getSQLiteAsync } from './api-instances.js';
+import { getSQLite, getSQLiteAsync, getSQLiteJSPI } from './api-instances.js';
 import * as SQLite from '../src/sqlite-api.js';
 import * as VFS from '../src/VFS.js';
 import { MemoryAsyncVFS } from '../src/examples/MemoryAsyncVFS.js';
 import { MemoryVFS } from '../src/examples/MemoryVFS.js';
+import { MemoryHeapVFS } from '../src/examples/MemoryHeapVFS.js';
 import { IDBVersionedVFS } from '../src/examples/IDBVersionedVFS.js';
 import { IDBMinimalVFS } from '../src/examples/IDBMinimalVFS.js';
 import { IDBBatchAtomicVFS } from '../src/examples/IDBBatchAtomicVFS.js';
@@ -512,6 +513,101 @@ function shared(ready) {
     expect(result[0][0]).toBeGreaterThan(0);
   });
 
+  it('wal', async function() {
+    // WAL is only available if the VFS provides shared memory.
+    const expectedMode = vfs.xShmMap ? 'wal' : 'delete';
+    await sql`PRAGMA journal_mode = DELETE`;
+    const mode = await sql`PRAGMA journal_mode = WAL`;
+    expect(mode[0][0]).toBe(expectedMode);
+
+    await sql`
+      CREATE TABLE foo (x PRIMARY KEY);
+      BEGIN;
+      INSERT INTO foo VALUES (1), (2), (3);
+      COMMIT;
+      BEGIN;
+      INSERT INTO foo VALUES (4), (5);
+      ROLLBACK;
+    `;
+    const resultA = await sql`SELECT COUNT(*) FROM foo`;
+    expect(resultA[0][0]).toBe(3);
+
+    // Reading from a second connection uses the same WAL index.
+    const db2 = await sqlite3.open_v2('foo', 0x06, vfs.name);
+    const resultB = [];
+    await sqlite3.exec(db2, `SELECT COUNT(*) FROM foo`, row => resultB.push(row));
+    expect(resultB[0][0]).toBe(3);
+    await sqlite3.close(db2);
+
+    // Checkpoint and leave WAL mode, then check the data after reopen.
+    await sql`PRAGMA journal_mode = DELETE`;
+    await sqlite3.close(db);
+    db = await sqlite3.open_v2('foo', 0x06, vfs.name);
+    const resultC = await sql`SELECT COUNT(*) FROM foo`;
+    expect(resultC[0][0]).toBe(3);
+  });
+
+  it('wal with two writers', async function() {
+    // Each connection sees the WAL file grow and shrink through the
+    // other, which must not be hidden by a cached file size.
+    await sql`PRAGMA journal_mode = DELETE`;
+    const mode = await sql`PRAGMA journal_mode = WAL`;
+    if (mode[0][0] !== 'wal') return;
+
+    await sql`
+      PRAGMA journal_size_limit = 0;
+      CREATE TABLE foo (x);
+    `;
+    const db2 = await sqlite3.open_v2('foo', 0x06, vfs.name);
+    try {
+      await sqlite3.exec(db2, `PRAGMA journal_size_limit = 0`);
+      for (let i = 0; i < 10; ++i) {
+        const writer = i % 2 ? db2 : db;
+        await sqlite3.exec(writer, `
+          WITH RECURSIVE numbers(n) AS
+            (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT ${i + 1})
+            INSERT INTO foo SELECT randomblob(1000) FROM numbers;
+        `);
+        if (i % 3 === 2) {
+          await sqlite3.exec(writer, `PRAGMA wal_checkpoint(TRUNCATE)`);
+        }
+      }
+
+      const expected = 55;
+      for (const reader of [db, db2]) {
+        const result = [];
+        await sqlite3.exec(reader, `
+          PRAGMA integrity_check;
+          SELECT COUNT(*) FROM foo;
+        `, row => result.push(row));
+        expect(result).toEqual([['ok'], [expected]]);
+      }
+    } finally {
+      await sqlite3.close(db2);
+    }
+    await sql`PRAGMA journal_mode = DELETE`;
+  });
+
+  it('read-ahead', async function() {
+    await loadSampleTable(sqlite3, db);
+
+    // Scan the table from a new connection so pages are not cached.
+    const xReadAhead = vfs.xReadAhead && sinon.spy(vfs, 'xReadAhead');
+    const db2 = await sqlite3.open_v2('foo', 0x06, vfs.name);
+    try {
+      const result = [];
+      await sqlite3.exec(db2, `SELECT SUM(Volume) FROM goog`, row => result.push(row));
+      const expected = GOOG.rows.reduce((sum, row) => sum + row[5], 0);
+      expect(result[0][0]).toBe(expected);
+      if (xReadAhead) {
+        expect(xReadAhead.callCount).toBeGreaterThan(0);
+      }
+    } finally {
+      await sqlite3.close(db2);
+      xReadAhead?.restore();
+    }
+  });
+
   it('time', async function() {
     const result = await sql`SELECT datetime('now', 'localtime');`;
     const date = new Date(result[0][0].replace(' ', 'T'));
@@ -533,7 +629,160 @@ describe('MemoryVFS', function() {
     resolveReady({ sqlite3 , vfs });
   });
 
-  shared(ready);
+  const setup = shared(ready);
+
+  it('xRead allocations', async function() {
+    const sqlite3 = setup.sqlite3;
+
+    // Count distinct argument objects passed to xRead. Dispatch reuses
+    // argument wrappers and caches heap views, so these should not grow
+    // with the number of calls.
+    class CountingVFS extends MemoryVFS {
+      name = 'memory-counting';
+      nReads = 0;
+      nViewMisses = 0;
+      wrappers = new Set();
+      views = new Set();
+
+      xRead(fileId, pData, iOffset) {
+        this.nReads++;
+        this.wrappers.add(pData);
+        this.views.add(pData.value);
+        if (pData.value !== pData.value) this.nViewMisses++;
+        return super.xRead(fileId, pData, iOffset);
+      }
+    }
+    const vfs = new CountingVFS();
+    sqlite3.vfs_register(vfs, false);
+
+    let db = await sqlite3.open_v2('foo', 0x06, vfs.name);
+    await loadSampleTable(sqlite3, db);
+    await sqlite3.close(db);
+
+    db = await sqlite3.open_v2('foo', 0x06, vfs.name);
+    try {
+      await sqlite3.exec(db, `PRAGMA cache_size = 4`);
+      for (let i = 0; i < 16; ++i) {
+        await sqlite3.exec(db, `SELECT SUM(Volume) FROM goog`);
+      }
+
+      // The same wrapper is passed on every call, the same view is
+      // returned for repeated access to the same buffer, and page
+      // buffers reused by SQLite reuse their views.
+      expect(vfs.nReads).toBeGreaterThan(16);
+      expect(vfs.wrappers.size).toBe(1);
+      expect(vfs.nViewMisses).toBe(0);
+      expect(vfs.views.size).toBeLessThan(vfs.nReads);
+    } finally {
+      await sqlite3.close(db);
+    }
+  });
+
+  it('fileData', async function() {
+    const sqlite3 = setup.sqlite3;
+
+    // Store a per-file value in the SQLite file object and check that
+    // it is available on each call.
+    class FileDataVFS extends MemoryVFS {
+      name = 'memory-file-data';
+      fileDataSize = 4;
+      nextTag = 1;
+      mismatches = 0;
+
+      xOpen(name, fileId, flags, pOutFlags) {
+        const tags = new Int32Array(this.heap.HEAP8.buffer);
+        tags[this.fileData(fileId) >> 2] = this.nextTag;
+        this.mapIdToTag.set(fileId, this.nextTag++);
+        return super.xOpen(name, fileId, flags, pOutFlags);
+      }
+
+      xRead(fileId, pData, iOffset) {
+        this.#check(fileId);
+        return super.xRead(fileId, pData, iOffset);
+      }
+
+      xWrite(fileId, pData, iOffset) {
+        this.#check(fileId);
+        return super.xWrite(fileId, pData, iOffset);
+      }
+
+      mapIdToTag = new Map();
+      #check(fileId) {
+        const tags = new Int32Array(this.heap.HEAP8.buffer);
+        if (tags[this.fileData(fileId) >> 2] !== this.mapIdToTag.get(fileId)) {
+          this.mismatches++;
+        }
+      }
+    }
+    const vfs = new FileDataVFS();
+    sqlite3.vfs_register(vfs, false);
+
+    const db = await sqlite3.open_v2('foo', 0x06, vfs.name);
+    try {
+      await loadSampleTable(sqlite3, db);
+      const result = [];
+      await sqlite3.exec(db, `SELECT COUNT(*) FROM goog`, row => result.push(row));
+      expect(result[0][0]).toBeGreaterThan(0);
+      expect(vfs.nextTag).toBeGreaterThan(1);
+      expect(vfs.mismatches).toBe(0);
+    } finally {
+      await sqlite3.close(db);
+    }
+  });
+
+  it('default methods', async function() {
+    const sqlite3 = setup.sqlite3;
+
+    // Overrides can call the VFS.Base defaults, and are called instead
+    // of the handling in C.
+    class LockCountVFS extends MemoryVFS {
+      name = 'memory-lock-count';
+      nLocks = 0;
+      nSyncs = 0;
+
+      xLock(fileId, flags) {
+        this.nLocks++;
+        return super.xLock(fileId, flags);
+      }
+
+      xSync(fileId, flags) {
+        this.nSyncs++;
+        return super.xSync(fileId, flags);
+      }
+    }
+    const vfs = new LockCountVFS();
+    sqlite3.vfs_register(vfs, false);
+    expect(vfs.xUnlock(0, VFS.SQLITE_LOCK_NONE)).toBe(VFS.SQLITE_OK);
+    expect(vfs.xFileControl(0, 0, null)).toBe(VFS.SQLITE_NOTFOUND);
+    expect(vfs.xSectorSize(0)).toBe(0);
+
+    const db = await sqlite3.open_v2('foo', 0x06, vfs.name);
+    try {
+      await loadSampleTable(sqlite3, db);
+      const result = [];
+      await sqlite3.exec(db, `SELECT COUNT(*) FROM goog`, row => result.push(row));
+      expect(result[0][0]).toBeGreaterThan(0);
+      expect(vfs.nLocks).toBeGreaterThan(0);
+      expect(vfs.nSyncs).toBeGreaterThan(0);
+    } finally {
+      await sqlite3.close(db);
+    }
+  });
+
+  it('URI filename', async function() {
+    const sqlite3 = setup.sqlite3;
+    const { vfs } = await ready;
+
+    // URI query parameters are passed to xOpen as part of the name.
+    const xOpen = sinon.spy(vfs, 'xOpen');
+    const db = await sqlite3.open_v2('file:bar?a=1&b=two', 0x46, vfs.name);
+    try {
+      expect(xOpen.firstCall.args[0]).toBe('bar?a=1&b=two');
+    } finally {
+      xOpen.restore();
+      await sqlite3.close(db);
+    }
+  });
 });
 
 describe('MemoryAsyncVFS', function() {
@@ -549,6 +798,139 @@ describe('MemoryAsyncVFS', function() {
   });
 
   shared(ready);
+
+  // xRead waits before copying so calls from different connections
+  // overlap, and records its argument wrappers and whether they changed
+  // while it waited.
+  class DelayVFS extends MemoryAsyncVFS {
+    name = 'memory-delay';
+    nReads = 0;
+    nChanged = 0;
+    wrappers = new Set();
+
+    xRead(fileId, pData, iOffset) {
+      return this.handleAsync(async () => {
+        this.nReads++;
+        this.wrappers.add(pData);
+        const { ptr, size } = pData;
+        await new Promise(resolve => setTimeout(resolve, this.nReads % 3));
+        if (pData.ptr !== ptr || pData.size !== size) this.nChanged++;
+        return MemoryVFS.prototype.xRead.call(this, fileId, pData, iOffset);
+      });
+    }
+  }
+
+  /**
+   * Read the sample table from two connections, one after the other or
+   * concurrently.
+   * @param {SQLiteAPI} sqlite3
+   * @param {DelayVFS} vfs
+   * @param {boolean} concurrent
+   */
+  async function readTwice(sqlite3, vfs, concurrent) {
+    sqlite3.vfs_register(vfs, false);
+    for (const name of ['a', 'b']) {
+      const db = await sqlite3.open_v2(name, 0x06, vfs.name);
+      await loadSampleTable(sqlite3, db);
+      await sqlite3.close(db);
+    }
+
+    const dbs = [];
+    try {
+      for (const name of ['a', 'b']) {
+        const db = await sqlite3.open_v2(name, 0x06, vfs.name);
+        dbs.push(db);
+        await sqlite3.exec(db, `PRAGMA cache_size = 4`);
+      }
+
+      const sum = async db => {
+        let result;
+        await sqlite3.exec(db, `SELECT SUM(Volume) FROM goog`, row => result = row[0]);
+        return result;
+      };
+      const results = concurrent ?
+        await Promise.all(dbs.map(sum)) :
+        [await sum(dbs[0]), await sum(dbs[1])];
+
+      const expected = GOOG.rows.reduce((sum, row) => sum + row[5], 0);
+      expect(results).toEqual([expected, expected]);
+      expect(vfs.nReads).toBeGreaterThan(0);
+      expect(vfs.wrappers.size).toBe(vfs.nReads);
+      expect(vfs.nChanged).toBe(0);
+    } finally {
+      for (const db of dbs) {
+        await sqlite3.close(db);
+      }
+    }
+  }
+
+  it('argument wrappers per call', async function() {
+    // An Asyncify build makes one call at a time, but each call must
+    // still get its own argument wrappers.
+    const { sqlite3 } = await ready;
+    await readTwice(sqlite3, new DelayVFS(), false);
+  });
+
+  it('interleaved connections', async function() {
+    // Only JSPI allows a second connection to enter the VFS while a
+    // call from the first is suspended.
+    const sqlite3 = await getSQLiteJSPI();
+    if (!sqlite3) {
+      pending('JSPI build not available');
+    }
+    await readTwice(sqlite3, new DelayVFS(), true);
+  });
+});
+
+describe('MemoryHeapVFS', function() {
+  let resolveReady;
+  let ready = new Promise(resolve => {
+    resolveReady = resolve;
+  });
+  beforeAll(async function() {
+    const sqlite3 = await getSQLite();
+    const vfs = new MemoryHeapVFS();
+    sqlite3.vfs_register(vfs, false);
+    resolveReady({ sqlite3 , vfs });
+  });
+
+  const setup = shared(ready);
+
+  it('mmap', async function() {
+    const sqlite3 = setup.sqlite3;
+    const sql = setup.sql;
+    const vfs = (await ready).vfs;
+
+    await loadSampleTable(sqlite3, setup.db);
+    const expected = await sql`SELECT COUNT(*), SUM(Volume) FROM goog`;
+
+    // Use a new connection so the page cache is empty.
+    const db = await sqlite3.open_v2('foo', 0x06, vfs.name);
+    const xFetch = sinon.spy(vfs, 'xFetch');
+    const xRead = sinon.spy(vfs, 'xRead');
+    try {
+      await sqlite3.exec(db, `PRAGMA mmap_size = 67108864`);
+      const result = [];
+      await sqlite3.exec(db, `SELECT COUNT(*), SUM(Volume) FROM goog`, row => {
+        result.push(row);
+      });
+      expect(result).toEqual(expected);
+      expect(xFetch.called).toBeTrue();
+      expect(xRead.callCount).toBeLessThan(xFetch.callCount);
+
+      // Writes must be visible through mapped pages.
+      await sql`UPDATE goog SET Volume = 0`;
+      const updated = [];
+      await sqlite3.exec(db, `SELECT SUM(Volume) FROM goog`, row => {
+        updated.push(row);
+      });
+      expect(updated[0][0]).toBe(0);
+    } finally {
+      xFetch.restore();
+      xRead.restore();
+      await sqlite3.close(db);
+    }
+  });
 });
 
 // Explore the IndexedDB filesystem without using SQLite.
@@ -709,6 +1091,50 @@ describe('IDBBatchAtomicVFS', function() {
 
   const setup = shared(ready);
 
+  it('calls constant methods once per file', async function() {
+    const sqlite3 = setup.sqlite3;
+    const db = setup.db;
+    const { vfs } = await ready;
+
+    const xOpen = sinon.spy(vfs, 'xOpen');
+    const xSectorSize = sinon.spy(vfs, 'xSectorSize');
+    const xDeviceCharacteristics = sinon.spy(vfs, 'xDeviceCharacteristics');
+    try {
+      await loadSampleTable(sqlite3, db);
+      await setup.sql`DELETE FROM goog WHERE Close > Open`;
+      expect(xDeviceCharacteristics.callCount).toBeLessThanOrEqual(xOpen.callCount + 1);
+      expect(xSectorSize.callCount).toBeLessThanOrEqual(xOpen.callCount + 1);
+    } finally {
+      xOpen.restore();
+      xSectorSize.restore();
+      xDeviceCharacteristics.restore();
+    }
+  });
+
+  it('batches writes', async function() {
+    const sqlite3 = setup.sqlite3;
+    const db = setup.db;
+    const { vfs } = await ready;
+
+    const xWrite = sinon.spy(vfs, 'xWrite');
+    const xWriteBatch = sinon.spy(vfs, 'xWriteBatch');
+    try {
+      await loadSampleTable(sqlite3, db);
+      const nWrites = xWriteBatch.getCalls()
+        .reduce((sum, call) => sum + call.args[1].length, 0);
+      expect(xWrite.callCount).toBe(0);
+      expect(xWriteBatch.callCount).toBeGreaterThan(0);
+      expect(xWriteBatch.callCount).toBeLessThan(nWrites);
+    } finally {
+      xWrite.restore();
+      xWriteBatch.restore();
+    }
+
+    // Check that the data was written.
+    const rows = await setup.sql`SELECT COUNT(*) FROM goog`;
+    expect(rows[0][0]).toBe(GOOG.rows.length);
+  });
+
   it('xTruncate reduces filesize', async function() {
     const sqlite3 = setup.sqlite3;
     const db = setup.db;
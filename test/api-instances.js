@@ -16,4 +16,12 @@ export const getSQLiteAsync = (function() {
     return SQLite.Factory(module);
   });
   return () => sqlite3;
-})();
\ No newline at end of file
+})();
+// The JSPI build is only made by "make jspi", so it is loaded on demand
+// and resolves to null if it is not present.
+export const getSQLiteJSPI = (function() {
+  let sqlite3;
+  return () => sqlite3 ??= import('../dist/wa-sqlite-jspi.mjs').then(
+    ({ default: factory }) => factory().then(module => SQLite.Factory(module)),
+    () => null);
+})();
@@ -0,0 +1,152 @@
+// @ts-ignore
+import SQLiteESMFactory from '../dist/wa-sqlite.mjs';
+import * as SQLite from '../src/sqlite-api.js';
+
+// Checks for API functions that call WebAssembly exports directly or
+// move data in bulk. Timing comparisons are in bench/bindings.js.
+describe('bindings', function() {
+  let Module;
+  /** @type {SQLiteAPI} */ let sqlite3;
+  let db;
+  beforeAll(async function() {
+    Module = await SQLiteESMFactory();
+    sqlite3 = SQLite.Factory(Module);
+  });
+
+  beforeEach(async function() {
+    db = await sqlite3.open_v2('bindings');
+  });
+
+  afterEach(async function() {
+    await sqlite3.close(db);
+  });
+
+  const N_ROWS = 1000;
+
+  it('column', async function() {
+    // Each direct column accessor matches the value from the export
+    // called through ccall.
+    const ccall = (fname, returnType, stmt, i) => {
+      return Module.ccall(fname, returnType, ['number', 'number'], [stmt, i]);
+    };
+    const sql = `
+      SELECT 42, -7.5, 'text', x'0102', NULL, 1 << 40;
+    `;
+    for await (const stmt of sqlite3.statements(db, sql)) {
+      expect(await sqlite3.step(stmt)).toBe(SQLite.SQLITE_ROW);
+      expect(sqlite3.column_count(stmt)).toBe(6);
+      expect(sqlite3.data_count(stmt)).toBe(6);
+      for (let i = 0; i < 6; ++i) {
+        expect(sqlite3.column_type(stmt, i)).toBe(ccall('sqlite3_column_type', 'number', stmt, i));
+        expect(sqlite3.column_int(stmt, i)).toBe(ccall('sqlite3_column_int', 'number', stmt, i));
+        expect(sqlite3.column_double(stmt, i)).toBe(ccall('sqlite3_column_double', 'number', stmt, i));
+        expect(sqlite3.column_bytes(stmt, i)).toBe(ccall('sqlite3_column_bytes', 'number', stmt, i));
+      }
+      const row = sqlite3.row(stmt);
+      row[3] = Array.from(row[3]);
+      expect(row).toEqual([42, -7.5, 'text', [1, 2], null, 2 ** 40]);
+    }
+  });
+
+  it('text', async function() {
+    // ASCII and multi-byte text on each side of the length where
+    // decoding switches from the ASCII loop to TextDecoder.
+    const values = [
+      '', 'a', 'x'.repeat(31), 'x'.repeat(32), 'x'.repeat(33),
+      'caf\u00e9', '\u00e9'.repeat(16), '\u00e9'.repeat(17),
+      'x'.repeat(31) + '\u00e9', '\u4e2d\ud83d\ude00'.repeat(10),
+      'hex '.repeat(1000), 'nul\u0000inside'
+    ];
+
+    await sqlite3.exec(db, `CREATE TABLE tbl (x)`);
+    for await (const stmt of sqlite3.statements(db, 'INSERT INTO tbl VALUES (?)')) {
+      for (const value of values) {
+        sqlite3.bind_text(stmt, 1, value);
+        await sqlite3.step(stmt);
+        await sqlite3.reset(stmt);
+      }
+    }
+
+    // Read as columns and as function arguments.
+    const args = [];
+    sqlite3.create_function(db, 'echo', 1, SQLite.SQLITE_UTF8, 0, (context, values) => {
+      args.push(sqlite3.value_text(values[0]));
+      sqlite3.result_null(context);
+    });
+    const columns = [];
+    for await (const stmt of sqlite3.statements(db, 'SELECT x, echo(x) FROM tbl ORDER BY rowid')) {
+      while (await sqlite3.step(stmt) === SQLite.SQLITE_ROW) {
+        columns.push(sqlite3.column_text(stmt, 0));
+      }
+    }
+    expect(columns).toEqual(values);
+    expect(args).toEqual(values);
+  });
+
+  it('decoded function', async function() {
+    // The same scalar function with pointer arguments read with
+    // sqlite3.value, and with arguments decoded in C, over all value
+    // types.
+    sqlite3.create_function(db, 'describe_values', 2, SQLite.SQLITE_UTF8, 0, (context, values) => {
+      sqlite3.result(context, JSON.stringify(values.map(value => {
+        const result = sqlite3.value(value);
+        return result instanceof Int8Array ? Array.from(result) : result;
+      })));
+    });
+    sqlite3.create_function_decoded(db, 'describe_decoded', 2, SQLite.SQLITE_UTF8, 0, (context, args) => {
+      sqlite3.result(context, JSON.stringify(args.map(arg => {
+        return arg instanceof Int8Array ? Array.from(arg) : arg;
+      })));
+    });
+
+    const results = [];
+    await sqlite3.exec(db, `
+      WITH RECURSIVE numbers(n) AS
+        (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT ${N_ROWS})
+        SELECT describe_values(n, v), describe_decoded(n, v)
+          FROM numbers, (SELECT n * 0.5 AS v UNION ALL SELECT 'text ' || n
+            UNION ALL SELECT x'00ff' UNION ALL SELECT NULL);
+    `, row => {
+      results.push(row);
+    });
+    expect(results.length).toBe(N_ROWS * 4);
+    for (const [values, decoded] of results) {
+      expect(decoded).toBe(values);
+    }
+  });
+
+  it('column aggregate', async function() {
+    // The same sum of products as an aggregate called per row, and as a
+    // column aggregate called once with columns.
+    let sum = 0;
+    sqlite3.create_function(db, 'dot_rows', 2, SQLite.SQLITE_UTF8, 0, null,
+      (context, values) => {
+        sum += sqlite3.value_double(values[0]) * sqlite3.value_double(values[1]);
+      },
+      context => {
+        sqlite3.result(context, sum);
+        sum = 0;
+      });
+    sqlite3.create_column_aggregate(db, 'dot_columns', 2, SQLite.SQLITE_UTF8, 0, (context, [a, b]) => {
+      let sum = 0;
+      for (let i = 0; i < a.length; ++i) {
+        sum += a[i] * b[i];
+      }
+      sqlite3.result(context, sum);
+    });
+
+    const results = [];
+    await sqlite3.exec(db, `
+      WITH RECURSIVE numbers(n) AS
+        (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT ${N_ROWS})
+        SELECT n % 7, dot_rows(n, 0.5), dot_columns(n, 0.5) FROM numbers
+          GROUP BY n % 7;
+    `, row => {
+      results.push(row);
+    });
+    expect(results.length).toBe(7);
+    for (const [, rows, columns] of results) {
+      expect(columns).toBe(rows);
+    }
+  });
+});
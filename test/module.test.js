@@ -53,6 +53,49 @@ function common(ModuleClass, setup) {
     expect(array.length).toBe(3);
     expect(array[1]).toBe(null);
   });
+
+  it('64-bit values', async function() {
+    /** @type {SQLiteAPI} */ const sqlite3 = setup.sqlite3;
+    const db = setup.db;
+
+    // 64-bit index info fields and rowids are numbers in modules, and
+    // can be set from numbers or BigInt.
+    const indexInfos = [];
+    const offset = 2 ** 40;
+    class BigModule extends ModuleClass {
+      xBestIndex(pVTab, indexInfo) {
+        indexInfos.push({ ...indexInfo });
+        indexInfo.estimatedRows = indexInfo.estimatedRows / 3;
+        return super.xBestIndex(pVTab, indexInfo);
+      }
+
+      xRowid(pCursor, pRowid) {
+        const cursorState = this.mapCursorToState.get(pCursor);
+        pRowid.set(cursorState.index % 2 ?
+          offset + cursorState.index :
+          BigInt(offset + cursorState.index));
+        return SQLite.SQLITE_OK;
+      }
+    }
+
+    const module = new BigModule(sqlite3, db, [['a'], ['b']], ['x']);
+    sqlite3.create_module(db, 'bigmod', module);
+
+    const results = [];
+    await sqlite3.exec(db, `
+      CREATE VIRTUAL TABLE bvt USING bigmod;
+      SELECT rowid, x FROM bvt;
+      DROP TABLE bvt;
+    `, function(row) { results.push(row); });
+    expect(results).toEqual([[offset, 'a'], [offset + 1, 'b']]);
+
+    expect(indexInfos.length).toBeGreaterThan(0);
+    for (const indexInfo of indexInfos) {
+      expect(typeof indexInfo.estimatedRows).toBe('number');
+      expect(typeof indexInfo.colUsed).toBe('number');
+      expect(indexInfo.colUsed & 1).toBe(1);
+    }
+  });
 }
 
 describe('ArrayModule', function() {
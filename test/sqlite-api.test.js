@@ -114,6 +114,180 @@ function shared(sqlite3Ready) {
     expect(results[1]).toEqual(expected);
   });
 
+  it('bind text and blob', async function() {
+    await sqlite3.exec(db, `CREATE TABLE tbl (x)`);
+
+    // Bindings reuse and grow the same parameter buffer, and remain
+    // valid across reset.
+    const values = [
+      'short', 'much longer text '.repeat(100), '\u00e9\u4e2d\ud83d\ude00', '',
+      new Int8Array([1, 2, 3]), new Int8Array(1000).fill(7), new Int8Array(0)
+    ];
+    for await (const stmt of sqlite3.statements(db, 'INSERT INTO tbl VALUES (?)')) {
+      for (const value of values) {
+        sqlite3.bind(stmt, 1, value);
+        for (let i = 0; i < 2; ++i) {
+          expect(await sqlite3.step(stmt)).toBe(SQLite.SQLITE_DONE);
+          await sqlite3.reset(stmt);
+        }
+      }
+    }
+
+    const results = [];
+    await sqlite3.exec(db, 'SELECT x FROM tbl ORDER BY rowid', row => {
+      results.push(row[0] instanceof Int8Array ? Array.from(row[0]) : row[0]);
+    });
+    const expected = values.flatMap(value => {
+      value = value instanceof Int8Array ? Array.from(value) : value;
+      return [value, value];
+    });
+    expect(results).toEqual(expected);
+  });
+
+  it('failed bind keeps binding', async function() {
+    await sqlite3.exec(db, `CREATE TABLE tbl (x)`);
+    for await (const stmt of sqlite3.statements(db, 'INSERT INTO tbl VALUES (?) RETURNING x')) {
+      sqlite3.bind(stmt, 1, 'first');
+      expect(await sqlite3.step(stmt)).toBe(SQLite.SQLITE_ROW);
+
+      // Binding a statement that has not been reset is an error and
+      // must not disturb the existing text or blob binding.
+      expect(() => sqlite3.bind(stmt, 1, 'x'.repeat(1000))).toThrow();
+      expect(() => sqlite3.bind(stmt, 1, new Int8Array(1000))).toThrow();
+      expect(() => sqlite3.bind(stmt, 2, 'out of range')).toThrow();
+      await sqlite3.reset(stmt);
+      expect(await sqlite3.step(stmt)).toBe(SQLite.SQLITE_ROW);
+      expect(sqlite3.column(stmt, 0)).toBe('first');
+      await sqlite3.reset(stmt);
+    }
+
+    const results = [];
+    await sqlite3.exec(db, 'SELECT x FROM tbl', row => {
+      results.push(row[0]);
+    });
+    expect(results).toEqual(['first', 'first']);
+  });
+
+  it('str_appendall', async function() {
+    // Build a large script with many small appends.
+    const str = sqlite3.str_new(db, 'CREATE TABLE tbl (x);');
+    for (let i = 0; i < 50000; ++i) {
+      sqlite3.str_appendall(str, `INSERT INTO tbl VALUES (${i});`);
+    }
+    sqlite3.str_appendall(str, 'SELECT sum(x), count(*) FROM tbl;');
+
+    const results = [];
+    let prepared = { stmt: null, sql: sqlite3.str_value(str) };
+    while ((prepared = await sqlite3.prepare_v2(db, prepared.sql))) {
+      while (await sqlite3.step(prepared.stmt) === SQLite.SQLITE_ROW) {
+        results.push(sqlite3.row(prepared.stmt));
+      }
+      await sqlite3.finalize(prepared.stmt);
+    }
+    sqlite3.str_finish(str);
+    expect(results).toEqual([[50000 * 49999 / 2, 50000]]);
+  });
+
+  it('insert_many', async function() {
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (id INTEGER PRIMARY KEY, x, y);
+    `);
+
+    // Enough wide rows to take more than one batch.
+    const rows = [];
+    for (let i = 1; i <= 20000; ++i) {
+      rows.push([i, 'x'.repeat(100) + i, i % 2 ? i + 0.5 : 2 ** 40 + i]);
+    }
+    rows.push([20001, new Int8Array([1, 2, 3]), null]);
+    for await (const stmt of sqlite3.statements(db, 'INSERT INTO tbl VALUES (?, ?, ?)')) {
+      expect(await sqlite3.insert_many(stmt, rows)).toBe(SQLite.SQLITE_OK);
+    }
+
+    // Object rows with missing values.
+    for await (const stmt of sqlite3.statements(db, 'INSERT INTO tbl VALUES (:id, :x, :y)')) {
+      await sqlite3.insert_many(stmt, [{ ':id': 20002, ':x': 'foo' }]);
+    }
+
+    const results = [];
+    await sqlite3.exec(db, 'SELECT * FROM tbl ORDER BY id', row => {
+      results.push(row.map(value => {
+        return value instanceof Int8Array ? Array.from(value) : value;
+      }));
+    });
+    expect(results.length).toBe(20002);
+    expect(results.slice(0, 20000)).toEqual(rows.slice(0, 20000));
+    expect(results[20000]).toEqual([20001, [1, 2, 3], null]);
+    expect(results[20001]).toEqual([20002, 'foo', null]);
+
+    // A constraint failure stops at the failing row, and the error
+    // reports the number of rows executed.
+    for await (const stmt of sqlite3.statements(db, 'INSERT INTO tbl (id) VALUES (?)')) {
+      const error = await sqlite3.insert_many(stmt, [[30000], [1], [30001]]).then(
+        () => null,
+        e => e);
+      expect(error).toBeInstanceOf(SQLite.SQLiteError);
+      expect(error.code).toBe(SQLite.SQLITE_CONSTRAINT);
+      expect(error.rowsDone).toBe(1);
+    }
+    let count;
+    await sqlite3.exec(db, 'SELECT count(*) FROM tbl WHERE id >= 30000', row => {
+      count = row[0];
+    });
+    expect(count).toBe(1);
+  });
+
+  it('int64', async function() {
+    await sqlite3.exec(db, `CREATE TABLE tbl (x)`);
+
+    const big = 2n ** 62n + 1n;
+    const safe = 2 ** 40 + 1;
+    for await (const stmt of sqlite3.statements(db, 'INSERT INTO tbl VALUES (?), (?)')) {
+      sqlite3.bind(stmt, 1, big);
+      sqlite3.bind(stmt, 2, safe);
+      await sqlite3.step(stmt);
+    }
+
+    // Large safe integers are bound as INTEGER, not REAL.
+    let rows = [];
+    await sqlite3.exec(db, `SELECT x, typeof(x) FROM tbl`, row => rows.push(row));
+    expect(rows).toEqual([[Number(big), 'integer'], [safe, 'integer']]);
+
+    // Integers are BigInt when enabled for the database.
+    sqlite3.use_bigint(db);
+    rows = [];
+    await sqlite3.exec(db, `SELECT x FROM tbl`, row => rows.push(row));
+    expect(rows).toEqual([[big], [BigInt(safe)]]);
+
+    // BigInt function arguments and results.
+    sqlite3.create_function(
+      db, 'Increment', 1, SQLite.SQLITE_UTF8, 0,
+      (context, values) => {
+        sqlite3.result(context, sqlite3.value_int64(values[0]) + 1n);
+      },
+      null, null);
+    rows = [];
+    await sqlite3.exec(db, `SELECT Increment(x) FROM tbl`, row => rows.push(row));
+    expect(rows).toEqual([[big + 1n], [BigInt(safe) + 1n]]);
+
+    // The int64 functions also accept numbers, truncated to integers.
+    sqlite3.create_function(
+      db, 'Half', 1, SQLite.SQLITE_UTF8, 0,
+      (context, values) => {
+        sqlite3.result_int64(context, sqlite3.value_double(values[0]) / 2);
+      },
+      null, null);
+    rows = [];
+    for await (const stmt of sqlite3.statements(db, 'SELECT Half(?)')) {
+      sqlite3.bind_int64(stmt, 1, safe);
+      while (await sqlite3.step(stmt) === SQLite.SQLITE_ROW) {
+        rows.push(sqlite3.row(stmt));
+      }
+    }
+    expect(rows).toEqual([[BigInt(Math.trunc(safe / 2))]]);
+
+    sqlite3.use_bigint(db, false);
+  });
+
   it('exec', async function() {
     // Without callback.
     await sqlite3.exec(
@@ -183,6 +357,85 @@ function shared(sqlite3Ready) {
     expect(count).toBe(1);
   });
 
+  it('step_rows', async function() {
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (cBlob, cDouble, cInt, cNull, cText);
+      WITH numbers(n) AS
+        (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT 100)
+        INSERT INTO tbl
+          SELECT x'0102', n + 0.5, n * 0x100000000 + n, NULL, 'text ' || n
+          FROM numbers;
+    `);
+
+    for await (const stmt of sqlite3.statements(db, 'SELECT * FROM tbl ORDER BY cInt')) {
+      // Compare to one row at a time.
+      const expected = [];
+      while (await sqlite3.step(stmt) === SQLite.SQLITE_ROW) {
+        expected.push([
+          sqlite3.column_blob(stmt, 0).slice(),
+          sqlite3.column_double(stmt, 1),
+          sqlite3.column_double(stmt, 2),
+          sqlite3.column(stmt, 3),
+          sqlite3.column_text(stmt, 4)
+        ]);
+      }
+      await sqlite3.reset(stmt);
+
+      const rows = [];
+      let batch;
+      while ((batch = await sqlite3.step_rows(stmt, 32)).length) {
+        expect(batch.length).toBeLessThanOrEqual(32);
+        rows.push(...batch);
+      }
+      expect(rows.length).toBe(100);
+      expect(rows).toEqual(expected);
+      expect(rows[0][0]).toBeInstanceOf(Int8Array);
+
+      // Stepping after step_rows() finishes restarts the statement, and
+      // a following step_rows() continues from there.
+      await sqlite3.reset(stmt);
+      expect((await sqlite3.step_rows(stmt, 256)).length).toBe(100);
+      expect(await sqlite3.step(stmt)).toBe(SQLite.SQLITE_ROW);
+      expect((await sqlite3.step_rows(stmt, 256)).length).toBe(99);
+    }
+  });
+
+  it('stream', async function() {
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (x);
+      WITH numbers(n) AS
+        (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT 1000)
+        INSERT INTO tbl SELECT n FROM numbers;
+    `);
+
+    let sum = 0;
+    let nBatches = 0;
+    let previous = null;
+    const sql = 'SELECT x FROM tbl; SELECT 42 AS y';
+    for await (const batch of sqlite3.stream(db, sql, 100)) {
+      expect(batch.rows.length).toBeLessThanOrEqual(100);
+      if (previous) expect(batch).toBe(previous);
+      previous = batch;
+
+      if (batch.columns[0] === 'x') {
+        sum += batch.rows.reduce((acc, row) => acc + row[0], 0);
+      } else {
+        expect(batch.rows).toEqual([[42]]);
+      }
+      nBatches++;
+    }
+    expect(sum).toBe(1000 * 1001 / 2);
+    expect(nBatches).toBe(11);
+
+    // Breaking early finalizes the statement.
+    sinon.spy(sqlite3, 'finalize');
+    for await (const batch of sqlite3.stream(db, 'SELECT x FROM tbl', 10)) {
+      break;
+    }
+    // @ts-ignore
+    expect(sqlite3.finalize.calledOnce).toBeTrue();
+  });
+
   it('function', async function() {
     // Populate a table with each value type, one value per row.
     await sqlite3.exec(db, `CREATE TABLE tbl (value)`);
@@ -232,6 +485,94 @@ function shared(sqlite3Ready) {
     expect(appData).toBe(0x1234);
   });
 
+  it('function decoded', async function() {
+    await sqlite3.exec(db, `CREATE TABLE tbl (value)`);
+    for await (const stmt of sqlite3.statements(db, 'INSERT INTO tbl VALUES (?)')) {
+      await sqlite3.insert_many(stmt, [
+        [new Int8Array([8, 6, 7, 5, 3, 0, 9])], [Math.PI], [42], [null], ['foobar'], ['\u00e9t\u00e9']
+      ]);
+    }
+
+    // This function evaluates to its second argument.
+    let appData = null;
+    const args = [];
+    function f(context, values) {
+      appData = sqlite3.user_data(context);
+      args.push(values[1] instanceof Int8Array ? Array.from(values[1]) : values[1]);
+      sqlite3.result(context, values[1]);
+    }
+    const result = sqlite3.create_function_decoded(
+      db, "MyFunc", 2, SQLite.SQLITE_UTF8, 0x1234, f);
+    expect(result).toBe(SQLite.SQLITE_OK);
+
+    const values = [];
+    await sqlite3.exec(db, `SELECT MyFunc(0, value) FROM tbl ORDER BY rowid`, row => {
+      values.push(row[0] instanceof Int8Array ? Array.from(row[0]) : row[0]);
+    });
+    const expected = [[8, 6, 7, 5, 3, 0, 9], Math.PI, 42, null, 'foobar', '\u00e9t\u00e9'];
+    expect(args).toEqual(expected);
+    expect(values).toEqual(expected);
+    expect(appData).toBe(0x1234);
+  });
+
+  it('function flags', async function() {
+    function f(context, values) {
+      sqlite3.result(context, sqlite3.value_int(values[0]) * 2);
+    }
+
+    // Only deterministic functions can be used in an index.
+    sqlite3.create_function(
+      db, "MyVolatile", 1, SQLite.SQLITE_UTF8, 0, f, null, null);
+    sqlite3.create_function(
+      db, "MyDouble", 1,
+      SQLite.SQLITE_UTF8 | SQLite.SQLITE_DETERMINISTIC | SQLite.SQLITE_INNOCUOUS,
+      0, f, null, null);
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (value);
+      INSERT INTO tbl VALUES (1), (2), (3);
+      CREATE INDEX idx ON tbl (MyDouble(value));
+    `);
+    await expectAsync(
+      sqlite3.exec(db, `CREATE INDEX idx2 ON tbl (MyVolatile(value))`)
+    ).toBeRejectedWithError(SQLite.SQLiteError);
+
+    let result;
+    await sqlite3.exec(db, `SELECT value FROM tbl WHERE MyDouble(value) = 4`, row => {
+      result = row[0];
+    });
+    expect(result).toBe(2);
+  });
+
+  it('auxdata', async function() {
+    // Cache a compiled regular expression for a constant argument.
+    let nCompiled = 0;
+    function regexp(context, values) {
+      let re = sqlite3.get_auxdata(context, 0);
+      if (!re) {
+        re = new RegExp(sqlite3.value_text(values[0]));
+        sqlite3.set_auxdata(context, 0, re);
+        nCompiled++;
+      }
+      sqlite3.result(context, re.test(sqlite3.value_text(values[1])) ? 1 : 0);
+    }
+    sqlite3.create_function(
+      db, "regexp", 2, SQLite.SQLITE_UTF8 | SQLite.SQLITE_DETERMINISTIC,
+      0, regexp, null, null);
+
+    let result;
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (value);
+      WITH numbers(n) AS
+        (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT 100)
+        INSERT INTO tbl SELECT 'item ' || n FROM numbers;
+      SELECT count(*) FROM tbl WHERE value REGEXP '^item [0-9]$';
+    `, row => {
+      result = row[0];
+    });
+    expect(result).toBe(9);
+    expect(nCompiled).toBe(1);
+  });
+
   it('aggregate', async function() {
     // A real aggregate function would need to manage separate
     // invocations by keying off context but that is unnecessary
@@ -260,6 +601,184 @@ function shared(sqlite3Ready) {
     expect(result).toBe(10);
   });
 
+  it('aggregate context', async function() {
+    // Average kept in SQLite aggregate memory for each group.
+    function AvgStep(context, values) {
+      const state = sqlite3.aggregate_context_f64(context, 2);
+      state[0] += sqlite3.value_double(values[0]);
+      state[1]++;
+    }
+    function AvgFinal(context) {
+      const state = sqlite3.aggregate_context_f64(context, 2);
+      sqlite3.result(context, state[1] ? state[0] / state[1] : null);
+    }
+    const result = sqlite3.create_function(
+      db, "MyAvg", 1, SQLite.SQLITE_UTF8, 0, null, AvgStep, AvgFinal);
+    expect(result).toBe(SQLite.SQLITE_OK);
+
+    const results = [];
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (k, value);
+      WITH numbers(n) AS
+        (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT 1000)
+        INSERT INTO tbl SELECT n % 10, n FROM numbers;
+      SELECT k, MyAvg(value), avg(value) FROM tbl GROUP BY k ORDER BY k;
+      SELECT MyAvg(value) FROM tbl WHERE 0;
+    `, row => {
+      results.push(row);
+    });
+    expect(results.length).toBe(11);
+    for (const [k, myAvg, avg] of results.slice(0, 10)) {
+      expect(myAvg).toBe(avg);
+    }
+    expect(results[10]).toEqual([null]);
+
+    // Requesting no values does not allocate, so a final callback can
+    // tell whether any rows were stepped.
+    function MaxStep(context, values) {
+      const state = sqlite3.aggregate_context_f64(context, 1);
+      state[0] = Math.max(state[0], sqlite3.value_double(values[0]));
+    }
+    function MaxFinal(context) {
+      const state = sqlite3.aggregate_context_f64(context, 0);
+      sqlite3.result(context, state && sqlite3.aggregate_context_f64(context, 1)[0]);
+    }
+    sqlite3.create_function(
+      db, "MyMax", 1, SQLite.SQLITE_UTF8, 0, null, MaxStep, MaxFinal);
+    results.splice(0);
+    await sqlite3.exec(db, `
+      CREATE TABLE empty (value);
+      SELECT MyMax(value) FROM empty;
+      SELECT MyMax(value) FROM tbl;
+    `, row => {
+      results.push(row);
+    });
+    expect(results).toEqual([[null], [1000]]);
+  });
+
+  it('window function', async function() {
+    // Moving sum with state for each invocation keyed by context.
+    const sums = new Map();
+    let nSteps = 0;
+    function SumStep(context, values) {
+      nSteps++;
+      sums.set(context, (sums.get(context) ?? 0) + sqlite3.value_int(values[0]));
+    }
+    function SumFinal(context) {
+      sqlite3.result(context, sums.get(context) ?? 0);
+      sums.delete(context);
+    }
+    function SumValue(context) {
+      sqlite3.result(context, sums.get(context) ?? 0);
+    }
+    function SumInverse(context, values) {
+      sums.set(context, sums.get(context) - sqlite3.value_int(values[0]));
+    }
+
+    let result;
+    result = sqlite3.create_window_function(
+      db, "MySum", 1, SQLite.SQLITE_UTF8, 0,
+      SumStep, SumFinal, SumValue, SumInverse);
+    expect(result).toBe(SQLite.SQLITE_OK);
+
+    const results = [];
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (value);
+      WITH numbers(n) AS
+        (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT 100)
+        INSERT INTO tbl SELECT n FROM numbers;
+      SELECT MySum(value) OVER (ORDER BY value ROWS BETWEEN 2 PRECEDING AND CURRENT ROW)
+        FROM tbl;
+    `, row => {
+      results.push(row[0]);
+    });
+    expect(results.length).toBe(100);
+    expect(results.slice(0, 4)).toEqual([1, 3, 6, 9]);
+    expect(results[99]).toBe(98 + 99 + 100);
+
+    // Each row is added once, not once per frame it belongs to.
+    expect(nSteps).toBe(100);
+
+    // The function also works as a plain aggregate.
+    await sqlite3.exec(db, `SELECT MySum(value) FROM tbl`, row => {
+      result = row[0];
+    });
+    expect(result).toBe(5050);
+  });
+
+  it('column aggregate', async function() {
+    let nCalls = 0;
+    function dot(context, [a, b]) {
+      nCalls++;
+      expect(a).toBeInstanceOf(Float64Array);
+      let sum = 0;
+      for (let i = 0; i < a.length; ++i) {
+        if (!isNaN(a[i]) && !isNaN(b[i])) sum += a[i] * b[i];
+      }
+      sqlite3.result(context, sum);
+    }
+    function scale(context, [a]) {
+      sqlite3.result(context, a.map(x => x * 2));
+    }
+    sqlite3.create_column_aggregate(db, "dot", 2, SQLite.SQLITE_UTF8, 0, dot);
+    sqlite3.create_column_aggregate(db, "scale", 1, SQLite.SQLITE_UTF8, 0, scale);
+
+    const results = [];
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (k, a, b);
+      WITH numbers(n) AS
+        (SELECT 1 UNION ALL SELECT n + 1 FROM numbers LIMIT 1000)
+        INSERT INTO tbl SELECT n % 2, n, 0.5 FROM numbers;
+      INSERT INTO tbl VALUES (0, NULL, 1);
+      SELECT k, dot(a, b) FROM tbl GROUP BY k ORDER BY k;
+    `, row => {
+      results.push(row);
+    });
+    expect(results).toEqual([[0, 250500 / 2], [1, 250000 / 2]]);
+    expect(nCalls).toBe(2);
+
+    // A transformed column can be returned as bytes.
+    let blob;
+    await sqlite3.exec(db, `SELECT scale(a) FROM tbl WHERE a <= 3`, row => {
+      blob = row[0].slice();
+    });
+    const scaled = new Float64Array(blob.buffer);
+    expect(Array.from(scaled).sort()).toEqual([2, 4, 6]);
+  });
+
+  it('column aggregate values', async function() {
+    let columns;
+    sqlite3.create_column_aggregate(db, "collect", 2, SQLite.SQLITE_UTF8, 0, (context, values) => {
+      columns = values.map(column => Array.from(column));
+      sqlite3.result(context, values[0].length);
+    });
+
+    // NULL is passed as NaN and other values are converted to numbers,
+    // in row order.
+    let result;
+    await sqlite3.exec(db, `
+      SELECT collect(column1, column2) FROM (VALUES
+        (1, NULL), (NULL, 2.5), ('3', 'x'), (x'00', 9007199254740993));
+    `, row => result = row[0]);
+    expect(result).toBe(4);
+    expect(columns[0]).toEqual([1, NaN, 3, 0]);
+    expect(columns[1]).toEqual([NaN, 2.5, 0, 9007199254740992]);
+
+    // A group with no rows gets an empty column for each argument.
+    await sqlite3.exec(db, `
+      SELECT collect(column1, column2) FROM (VALUES (1, 2)) WHERE 0;
+    `, row => result = row[0]);
+    expect(result).toBe(0);
+    expect(columns).toEqual([[], []]);
+
+    // Each argument is a column, so the count must be fixed.
+    for (const nArg of [0, -1]) {
+      expect(() => {
+        sqlite3.create_column_aggregate(db, "bad", nArg, SQLite.SQLITE_UTF8, 0, () => {});
+      }).toThrowMatching(e => e.code === SQLite.SQLITE_MISUSE);
+    }
+  });
+
   it('statements', async function() {
     sinon.spy(sqlite3, 'finalize');
 
@@ -339,6 +858,109 @@ function shared(sqlite3Ready) {
     sqlite3.finalize.restore();
   });
 
+  it('prepare_cached', async function() {
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (x);
+      INSERT INTO tbl VALUES (1), (2);
+    `);
+
+    // Repeated SQL returns the same reset statement.
+    const sql = 'SELECT * FROM tbl ORDER BY x; SELECT 42';
+    const first = await sqlite3.prepare_cached(db, sql);
+    expect(first.tail).toBe('SELECT 42');
+    while (await sqlite3.step(first.stmt) === SQLite.SQLITE_ROW);
+    const second = await sqlite3.prepare_cached(db, sql);
+    expect(second.stmt).toBe(first.stmt);
+    expect(await sqlite3.step(second.stmt)).toBe(SQLite.SQLITE_ROW);
+    expect(sqlite3.column(second.stmt, 0)).toBe(1);
+
+    const tail = await sqlite3.prepare_cached(db, second.tail);
+    expect(tail.tail).toBe('');
+    expect(await sqlite3.prepare_cached(db, '-- comment')).toBeNull();
+
+    // A schema change is picked up by the cached statement.
+    await sqlite3.reset(second.stmt);
+    await sqlite3.exec(db, `ALTER TABLE tbl ADD COLUMN y`);
+    const third = await sqlite3.prepare_cached(db, sql);
+    expect(third.stmt).toBe(first.stmt);
+    expect(await sqlite3.step(third.stmt)).toBe(SQLite.SQLITE_ROW);
+    expect(sqlite3.column_names(third.stmt)).toEqual(['x', 'y']);
+
+    // Shrinking the cache finalizes least recently used statements.
+    sinon.spy(sqlite3, 'finalize');
+    await sqlite3.prepare_cache_size(db, 1);
+    // @ts-ignore
+    expect(sqlite3.finalize.calledWith(third.stmt)).toBeFalse();
+    // @ts-ignore
+    expect(sqlite3.finalize.calledWith(tail.stmt)).toBeTrue();
+    await sqlite3.prepare_cached(db, 'SELECT 1');
+    // @ts-ignore
+    expect(sqlite3.finalize.calledWith(third.stmt)).toBeTrue();
+
+    // @ts-ignore
+    sqlite3.finalize.restore();
+  });
+
+  it('prepare_cached nested', async function() {
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (x);
+      INSERT INTO tbl VALUES (1), (2), (3);
+    `);
+
+    // Preparing SQL again while its cached statement is being stepped
+    // returns a different statement and leaves the outer one alone.
+    const sql = 'SELECT x FROM tbl ORDER BY x';
+    const outer = await sqlite3.prepare_cached(db, sql);
+    const results = [];
+    let innerStmt;
+    while (await sqlite3.step(outer.stmt) === SQLite.SQLITE_ROW) {
+      const x = sqlite3.column(outer.stmt, 0);
+      const inner = await sqlite3.prepare_cached(db, sql);
+      expect(inner.stmt).not.toBe(outer.stmt);
+      let sum = 0;
+      while (await sqlite3.step(inner.stmt) === SQLite.SQLITE_ROW) {
+        sum += sqlite3.column(inner.stmt, 0);
+      }
+      results.push([x, sum]);
+
+      // The extra statement is cached and reused too.
+      innerStmt ??= inner.stmt;
+      expect(inner.stmt).toBe(innerStmt);
+    }
+    expect(results).toEqual([[1, 6], [2, 6], [3, 6]]);
+  });
+
+  it('prepare_cached eviction while stepping', async function() {
+    await sqlite3.exec(db, `
+      CREATE TABLE tbl (x);
+      INSERT INTO tbl VALUES (1), (2), (3);
+    `);
+    await sqlite3.prepare_cache_size(db, 1);
+    sinon.spy(sqlite3, 'finalize');
+
+    // Preparing other SQL while a statement is being stepped pushes
+    // the statement out of the cache but does not finalize it.
+    const outer = await sqlite3.prepare_cached(db, 'SELECT x FROM tbl ORDER BY x');
+    const results = [];
+    while (await sqlite3.step(outer.stmt) === SQLite.SQLITE_ROW) {
+      results.push(sqlite3.column(outer.stmt, 0));
+      const inner = await sqlite3.prepare_cached(db, `SELECT ${results.length}`);
+      expect(await sqlite3.step(inner.stmt)).toBe(SQLite.SQLITE_ROW);
+      // @ts-ignore
+      expect(sqlite3.finalize.calledWith(outer.stmt)).toBeFalse();
+    }
+    expect(results).toEqual([1, 2, 3]);
+
+    // The next use of the cache after the statement is done
+    // finalizes it.
+    await sqlite3.prepare_cached(db, 'SELECT 42');
+    // @ts-ignore
+    expect(sqlite3.finalize.calledWith(outer.stmt)).toBeTrue();
+
+    // @ts-ignore
+    sqlite3.finalize.restore();
+  });
+
   it('rollback', async function() {
     let count;
     await sqlite3.exec(db, `
@@ -389,9 +1011,42 @@ function shared(sqlite3Ready) {
 describe('sqlite-api', function() {
   const sqlite3Ready = getSQLite();
   shared(sqlite3Ready);
+
+  it('sync', async function() {
+    const sqlite3 = await sqlite3Ready;
+    const db = sqlite3.open_v2_sync('sync');
+
+    const str = sqlite3.str_new(db, `
+      CREATE TABLE IF NOT EXISTS tbl (x);
+      DELETE FROM tbl;
+      INSERT INTO tbl VALUES (1), (2), (3);
+      SELECT sum(x) FROM tbl;
+    `);
+    const results = [];
+    let prepared = { stmt: null, sql: sqlite3.str_value(str) };
+    while ((prepared = sqlite3.prepare_v2_sync(db, prepared.sql))) {
+      for (let i = 0; i < 2; ++i) {
+        while (sqlite3.step_sync(prepared.stmt) === SQLite.SQLITE_ROW) {
+          results.push(sqlite3.row(prepared.stmt));
+        }
+        expect(sqlite3.reset_sync(prepared.stmt)).toBe(SQLite.SQLITE_OK);
+      }
+      expect(sqlite3.finalize_sync(prepared.stmt)).toBe(SQLite.SQLITE_OK);
+    }
+    sqlite3.str_finish(str);
+    expect(results).toEqual([[12], [12]]);
+
+    expect(sqlite3.close_sync(db)).toBe(SQLite.SQLITE_OK);
+  });
 });
 
 describe('sqlite-api async', function() {
   const sqlite3Ready = getSQLiteAsync();
   shared(sqlite3Ready);
+
+  it('sync', async function() {
+    // Synchronous variants are not available in an async build.
+    const sqlite3 = await sqlite3Ready;
+    expect(() => sqlite3.open_v2_sync('sync')).toThrowError(SQLite.SQLiteError);
+  });
 });
\ No newline at end of file
@@ -55,4 +55,18 @@ describe('tag', function() {
       }
     ]);
   });
-});
\ No newline at end of file
+
+  it('reuses statements', async function() {
+    await sql`CREATE TABLE abc (x)`;
+    spyOn(sqlite3, 'prepare_v2').and.callThrough();
+    for (let i = 0; i < 3; ++i) {
+      await sql`INSERT INTO abc VALUES (${i})`;
+      await sql`SELECT count(*) FROM abc`;
+    }
+    // One for each distinct SQL text.
+    expect(sqlite3.prepare_v2).toHaveBeenCalledTimes(4);
+
+    const result = await sql`SELECT count(*) FROM abc`;
+    expect(result[0].rows).toEqual([[3]]);
+  });
+});